@@ -0,0 +1,391 @@
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include "analyse.h"
+#include "epd.h"
+#include "movegen.h"
+#include "uci.h"
+#include "tt.h"
+
+namespace Belette {
+
+class AnalyseEngine : public Engine {
+public:
+    AnalyseEngine(TranspositionTable &tt_): Engine(tt_) { }
+
+    int depth = 0;
+    int selDepth = 0;
+    Score score = SCORE_NONE;
+    MoveList pv;
+    size_t nbNodes = 0;
+    TimeMs elapsed = 0;
+
+private:
+    virtual void onSearchProgress(const SearchEvent &event) { }
+    virtual void onSearchFinish(const SearchEvent &event) {
+        depth = event.depth;
+        selDepth = event.selDepth;
+        score = event.bestScore;
+        pv = event.pv;
+        nbNodes = event.nbNodes;
+        elapsed = event.elapsed;
+    }
+};
+
+std::string jsonString(const std::string &str) {
+    std::string escaped = "\"";
+
+    for (char c : str) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        if (c == '\t' || c == '\r' || c == '\n') continue;
+        escaped += c;
+    }
+
+    return escaped + "\"";
+}
+
+std::string jsonScore(Score score) {
+    std::stringstream ss;
+
+    if (std::abs(score) >= SCORE_MATE_MAX_PLY) {
+        ss << "{\"mate\":" << (score > 0 ? SCORE_MATE - score + 1 : -SCORE_MATE - score) / 2 << "}";
+    } else {
+        ss << "{\"cp\":" << score << "}";
+    }
+
+    return ss.str();
+}
+
+void analyse(const AnalyseParams &params) {
+    std::vector<EpdEntry> positions;
+
+    if (!loadEpdFile(params.filename, positions)) {
+        console << "Unable to open file '" << params.filename << "'" << std::endl;
+        return;
+    }
+
+    size_t ttSize = params.hashSize * 1024 * 1024;
+    std::unique_ptr<TranspositionTable> sharedTT;
+    if (params.sharedHash) sharedTT = std::make_unique<TranspositionTable>(ttSize);
+
+    std::atomic<size_t> nextPosition = 0;
+    std::atomic<size_t> totalNodes = 0;
+    std::mutex outputMutex;
+    TimeMs start = now();
+
+    auto worker = [&]() {
+        std::unique_ptr<TranspositionTable> ownTT;
+        if (!params.sharedHash) ownTT = std::make_unique<TranspositionTable>(ttSize);
+
+        AnalyseEngine engine(params.sharedHash ? *sharedTT : *ownTT);
+        size_t i;
+
+        // Aging the shared table for every position would have the workers replace each other's entries early
+        engine.setHashAging(!params.sharedHash);
+
+        while ((i = nextPosition++) < positions.size()) {
+            const EpdEntry &epd = positions[i];
+            std::stringstream ss;
+
+            ss << "{\"index\":" << i;
+            if (epd.operations.count("id")) ss << ",\"id\":" << jsonString(epd.operations.at("id"));
+            ss << ",\"fen\":" << jsonString(epd.fen);
+
+            if (!engine.position().setFromFEN(epd.fen)) {
+                ss << ",\"error\":\"invalid fen\"}";
+            } else {
+                engine.searchSync(params.limits);
+                totalNodes += engine.nbNodes;
+
+                ss << ",\"bestmove\":" << (engine.pv.empty() ? "null" : jsonString(Uci::formatMove(engine.pv.front())))
+                   << ",\"score\":" << jsonScore(engine.score)
+                   << ",\"depth\":" << engine.depth
+                   << ",\"seldepth\":" << engine.selDepth
+                   << ",\"nodes\":" << engine.nbNodes
+                   << ",\"time\":" << engine.elapsed
+                   << ",\"pv\":[";
+
+                for (auto m = engine.pv.begin(); m != engine.pv.end(); m++) {
+                    ss << (m != engine.pv.begin() ? "," : "") << jsonString(Uci::formatMove(*m));
+                }
+
+                ss << "]}";
+            }
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            console << ss.str() << std::endl;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i=0; i<std::max(1, params.nbThreads); i++) {
+        threads.emplace_back(worker);
+    }
+
+    for (auto &th : threads) {
+        th.join();
+    }
+
+    TimeMs elapsed = std::max<TimeMs>(1, now() - start);
+
+    console << "{\"summary\":{\"positions\":" << positions.size()
+            << ",\"threads\":" << params.nbThreads
+            << ",\"nodes\":" << totalNodes
+            << ",\"time\":" << elapsed
+            << ",\"nps\":" << 1000ull * totalNodes / elapsed
+            << "}}" << std::endl;
+}
+
+// Standard algebraic notation of a legal move, without the check suffix
+static std::string formatSan(const Position &pos, Move m) {
+    const Square from = moveFrom(m), to = moveTo(m);
+    const Piece pc = pos.getPieceAt(from);
+
+    if (moveType(m) == CASTLING) return to > from ? "O-O" : "O-O-O";
+
+    std::string san;
+    bool capture = !pos.isEmpty(to) || moveType(m) == EN_PASSANT;
+
+    if (pieceType(pc) == PAWN) {
+        if (capture) san += char('a' + fileOf(from));
+    } else {
+        san += " PNBRQK"[pieceType(pc)];
+
+        // Disambiguate with the file, the rank or both if another piece of the same type can go to the same square
+        bool ambiguous = false, sameFile = false, sameRank = false;
+        enumerateLegalMoves(pos, [&](Move other) {
+            const Square otherFrom = moveFrom(other);
+            if (moveTo(other) != to || otherFrom == from || pos.getPieceAt(otherFrom) != pc) return true;
+
+            ambiguous = true;
+            sameFile |= fileOf(otherFrom) == fileOf(from);
+            sameRank |= rankOf(otherFrom) == rankOf(from);
+            return true;
+        });
+
+        if (ambiguous) {
+            if (!sameFile) san += char('a' + fileOf(from));
+            else if (!sameRank) san += char('1' + rankOf(from));
+            else san += Uci::formatSquare(from);
+        }
+    }
+
+    if (capture) san += 'x';
+    san += Uci::formatSquare(to);
+
+    if (moveType(m) == PROMOTION) {
+        san += '=';
+        san += " PNBRQK"[movePromotionType(m)];
+    }
+
+    return san;
+}
+
+// Legal move from its UCI or SAN notation, check marks and annotation symbols are ignored
+static Move parseGameMove(const Position &pos, std::string str) {
+    while (!str.empty() && std::strchr("+#!?", str.back())) str.pop_back();
+    std::erase(str, '=');
+    std::replace(str.begin(), str.end(), '0', 'O'); // "0-0"
+
+    Move move = MOVE_NONE;
+    enumerateLegalMoves(pos, [&](Move m) {
+        std::string san = formatSan(pos, m);
+        std::erase(san, '=');
+
+        if (str == Uci::formatMove(m) || str == san) {
+            move = m;
+            return false;
+        }
+
+        return true;
+    });
+
+    return move;
+}
+
+// Moves of the first game of a PGN file. Comments, variations, move numbers, NAGs and results are skipped,
+// the FEN tag is used as starting position
+static bool loadPgnGame(const std::string &filename, std::string &fen, std::vector<std::string> &moves) {
+    std::ifstream file(filename);
+    if (!file.is_open()) return false;
+
+    std::string line, token;
+    bool inComment = false;
+    int variationLevel = 0;
+
+    auto addToken = [&]() {
+        size_t dot = token.find_last_of('.');
+        if (dot != std::string::npos) token = token.substr(dot + 1); // "12.e4", "12..."
+
+        if (!token.empty() && token[0] != '$' && token != "*" && token != "1-0" && token != "0-1" && token != "1/2-1/2")
+            moves.push_back(token);
+
+        token.clear();
+    };
+
+    while (std::getline(file, line)) {
+        if (!inComment && variationLevel == 0 && line.starts_with('[')) {
+            if (!moves.empty()) break; // Next game
+
+            if (line.starts_with("[FEN \"")) fen = line.substr(6, line.find('"', 6) - 6);
+            continue;
+        }
+
+        for (char c : line) {
+            if (inComment) {
+                if (c == '}') inComment = false;
+            } else if (c == '{') {
+                addToken();
+                inComment = true;
+            } else if (c == ';') {
+                break;
+            } else if (c == '(') {
+                addToken();
+                variationLevel++;
+            } else if (c == ')') {
+                variationLevel--;
+            } else if (variationLevel == 0) {
+                if (std::isspace(c)) addToken();
+                else token += c;
+            }
+        }
+
+        addToken();
+    }
+
+    return true;
+}
+
+// Mate scores count as a decisive advantage when computing the loss of a move
+static int lossScore(Score score) {
+    return std::clamp(int(score), -1000, 1000);
+}
+
+void annotate(const AnnotateParams &params) {
+    std::string fen = params.fen;
+    std::vector<std::string> tokens = params.moves;
+
+    if (!params.filename.empty()) {
+        tokens.clear();
+        if (!loadPgnGame(params.filename, fen, tokens)) {
+            console << "Unable to open file '" << params.filename << "'" << std::endl;
+            return;
+        }
+    }
+
+    auto tt = std::make_unique<TranspositionTable>(params.hashSize * 1024 * 1024);
+    auto engine = std::make_unique<AnalyseEngine>(*tt);
+    Position &pos = engine->position();
+
+    if (!pos.setFromFEN(fen)) {
+        console << "Invalid FEN position" << std::endl;
+        return;
+    }
+
+    std::vector<Move> moves;
+    std::vector<std::string> sanMoves;
+
+    for (auto &token : tokens) {
+        Move move = parseGameMove(pos, token);
+
+        if (move == MOVE_NONE) {
+            console << "Invalid move '" << token << "' at ply " << moves.size() + 1 << std::endl;
+            return;
+        }
+
+        std::string san = formatSan(pos, move);
+        pos.doMove(move);
+        if (pos.inCheck()) san += hasLegalMove(pos) ? "+" : "#";
+
+        moves.push_back(move);
+        sanMoves.push_back(san);
+    }
+
+    size_t totalNodes = 0;
+    int nbInaccuracies = 0, nbMistakes = 0, nbBlunders = 0;
+    Score childScore = SCORE_NONE; // Score of the position after the move, for the opponent
+    TimeMs start = now();
+
+    // From the final position back to the first one, the game is undone move by move so the searches still see
+    // the previous positions for repetitions
+    for (int ply = int(moves.size()); ply >= 0; ply--) {
+        Score score;
+        Move bestMove = MOVE_NONE;
+
+        if (!hasLegalMove(pos)) {
+            score = pos.inCheck() ? -SCORE_MATE : SCORE_DRAW;
+            engine->pv.clear();
+            engine->depth = engine->selDepth = 0;
+            engine->nbNodes = 0;
+            engine->elapsed = 0;
+        } else {
+            engine->searchSync(params.limits);
+            totalNodes += engine->nbNodes;
+            score = engine->score;
+            if (!engine->pv.empty()) bestMove = engine->pv.front();
+        }
+
+        if (ply < int(moves.size())) {
+            const Move move = moves[ply];
+            const Side us = pos.getSideToMove();
+
+            // Score of the played move one ply deeper than the child position
+            Score moveScore = -childScore;
+            if (moveScore >= SCORE_MATE_MAX_PLY) moveScore--;
+            else if (moveScore <= -SCORE_MATE_MAX_PLY) moveScore++;
+
+            int loss = move == bestMove ? 0 : std::max(0, lossScore(score) - lossScore(moveScore));
+            const char *flag = loss >= BLUNDER_MARGIN ? "blunder"
+                             : loss >= MISTAKE_MARGIN ? "mistake"
+                             : loss >= INACCURACY_MARGIN ? "inaccuracy" : nullptr;
+
+            nbBlunders += loss >= BLUNDER_MARGIN;
+            nbMistakes += loss >= MISTAKE_MARGIN && loss < BLUNDER_MARGIN;
+            nbInaccuracies += loss >= INACCURACY_MARGIN && loss < MISTAKE_MARGIN;
+
+            // Scores are given from white point of view
+            std::stringstream ss;
+            ss << "{\"ply\":" << ply + 1
+               << ",\"move\":" << jsonString(Uci::formatMove(move))
+               << ",\"san\":" << jsonString(sanMoves[ply])
+               << ",\"score\":" << jsonScore(us == WHITE ? moveScore : -moveScore)
+               << ",\"bestmove\":" << (bestMove == MOVE_NONE ? "null" : jsonString(Uci::formatMove(bestMove)))
+               << ",\"bestscore\":" << jsonScore(us == WHITE ? score : -score)
+               << ",\"loss\":" << loss
+               << ",\"flag\":" << (flag ? jsonString(flag) : "null")
+               << ",\"depth\":" << engine->depth
+               << ",\"nodes\":" << engine->nbNodes
+               << ",\"time\":" << engine->elapsed
+               << ",\"pv\":[";
+
+            for (auto m = engine->pv.begin(); m != engine->pv.end(); m++) {
+                ss << (m != engine->pv.begin() ? "," : "") << jsonString(Uci::formatMove(*m));
+            }
+
+            ss << "]}";
+            console << ss.str() << std::endl;
+        }
+
+        childScore = score;
+        if (ply > 0) pos.undoMove(moves[ply - 1]);
+    }
+
+    TimeMs elapsed = std::max<TimeMs>(1, now() - start);
+
+    console << "{\"summary\":{\"plies\":" << moves.size()
+            << ",\"inaccuracies\":" << nbInaccuracies
+            << ",\"mistakes\":" << nbMistakes
+            << ",\"blunders\":" << nbBlunders
+            << ",\"nodes\":" << totalNodes
+            << ",\"time\":" << elapsed
+            << ",\"nps\":" << 1000ull * totalNodes / elapsed
+            << "}}" << std::endl;
+}
+
+} /* namespace Belette */
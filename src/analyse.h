@@ -0,0 +1,43 @@
+#ifndef ANALYSE_H_INCLUDED
+#define ANALYSE_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include "engine.h"
+
+namespace Belette {
+
+constexpr int DEFAULT_ANALYSE_DEPTH = 10;
+constexpr int DEFAULT_ANNOTATE_DEPTH = 12;
+
+// Centipawns lost by a move compared to the best move
+constexpr int INACCURACY_MARGIN = 50;
+constexpr int MISTAKE_MARGIN = 100;
+constexpr int BLUNDER_MARGIN = 200;
+
+struct AnalyseParams {
+    std::string filename;
+    SearchLimits limits;
+    int nbThreads = 1;
+    size_t hashSize = 16; // In megabytes, per thread unless the table is shared
+    bool sharedHash = false;
+};
+
+// Analyse all positions of an EPD file using a pool of workers. Results are streamed as JSON lines
+void analyse(const AnalyseParams &params);
+
+struct AnnotateParams {
+    std::string fen = STARTPOS_FEN;
+    std::vector<std::string> moves; // UCI or SAN moves
+    std::string filename; // PGN file, used instead of fen and moves if given
+    SearchLimits limits;
+    size_t hashSize = 64; // In megabytes
+};
+
+// Annotate a game: positions are searched from the last one back to the first with the same transposition table,
+// so the results of the deeper positions seed the earlier ones. Results are streamed as JSON lines, last move first
+void annotate(const AnnotateParams &params);
+
+} /* namespace Belette */
+
+#endif /* ANALYSE_H_INCLUDED */
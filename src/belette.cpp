@@ -0,0 +1,220 @@
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include "belette.h"
+#include "bitboard.h"
+#include "cpu.h"
+#include "engine.h"
+#include "movegen.h"
+#include "perft.h"
+#include "tt.h"
+#include "uci.h"
+
+namespace Belette {
+
+static void copyString(char *dst, size_t size, const std::string &src) {
+    size_t n = std::min(size - 1, src.size());
+    std::memcpy(dst, src.data(), n);
+    dst[n] = '\0';
+}
+
+static void fillSearchInfo(BeletteSearchInfo &info, const SearchEvent &event) {
+    info.depth = event.depth;
+    info.seldepth = event.selDepth;
+    info.score = event.bestScore;
+    info.mate = 0;
+    if (std::abs(event.bestScore) >= SCORE_MATE_MAX_PLY && std::abs(event.bestScore) <= SCORE_MATE)
+        info.mate = (event.bestScore > 0 ? SCORE_MATE - event.bestScore + 1 : -SCORE_MATE - event.bestScore) / 2;
+    info.nodes = event.nbNodes;
+    info.time = event.elapsed;
+    info.hashfull = int(event.hashfull);
+
+    copyString(info.bestmove, sizeof(info.bestmove), Uci::formatMove(event.pv.empty() ? MOVE_NONE : event.pv[0]));
+    copyString(info.ponder, sizeof(info.ponder), event.pv.size() > 1 ? Uci::formatMove(event.pv[1]) : "");
+
+    std::string pv;
+    for (auto m = event.pv.begin(); m != event.pv.end(); m++) {
+        pv += (m != event.pv.begin() ? " " : "") + Uci::formatMove(*m);
+    }
+    copyString(info.pv, sizeof(info.pv), pv);
+}
+
+// Engine reporting its search to the callbacks given through the C API
+class LibraryEngine : public Engine {
+public:
+    LibraryEngine(TranspositionTable &tt_): Engine(tt_) { }
+
+    BeletteSearchCallback progress = nullptr;
+    BeletteSearchCallback finish = nullptr;
+    void *userData = nullptr;
+
+    BeletteSearchInfo result; // Final result of the last search
+
+private:
+    virtual void onSearchProgress(const SearchEvent &event) {
+        if (!progress) return;
+
+        BeletteSearchInfo info;
+        fillSearchInfo(info, event);
+        progress(&info, userData);
+    }
+
+    virtual void onSearchFinish(const SearchEvent &event) {
+        fillSearchInfo(result, event);
+        if (finish) finish(&result, userData);
+    }
+};
+
+static SearchLimits searchLimits(const BeletteLimits *limits) {
+    SearchLimits searchLimits;
+    if (!limits) return searchLimits;
+
+    searchLimits.maxDepth = limits->depth;
+    searchLimits.maxNodes = limits->nodes;
+    searchLimits.maxTime = limits->movetime;
+    searchLimits.timeLeft[WHITE] = limits->wtime;
+    searchLimits.timeLeft[BLACK] = limits->btime;
+    searchLimits.increment[WHITE] = limits->winc;
+    searchLimits.increment[BLACK] = limits->binc;
+    searchLimits.movesToGo = limits->movestogo;
+
+    return searchLimits;
+}
+
+static Move parseMove(const Position &pos, const char *str) {
+    std::string uciMove(str);
+    std::transform(uciMove.begin(), uciMove.end(), uciMove.begin(), ::tolower);
+
+    Move move = MOVE_NONE;
+    enumerateLegalMoves(pos, [&](Move m) {
+        if (uciMove != Uci::formatMove(m)) return true;
+
+        move = m;
+        return false;
+    });
+
+    return move;
+}
+
+// A table without buckets can't be searched
+static size_t hashBytes(size_t hashMb) {
+    return std::max<size_t>(hashMb, 1) * 1024 * 1024;
+}
+
+} /* namespace Belette */
+
+using namespace Belette;
+
+struct BeletteEngine {
+    std::unique_ptr<TranspositionTable> tt;
+    std::unique_ptr<LibraryEngine> engine;
+};
+
+extern "C" {
+
+const char *belette_version(void) {
+    return VERSION;
+}
+
+int belette_init(void) {
+    std::string missing;
+    if (!CPU::isSupported(missing)) return BELETTE_ERROR_CPU;
+
+    BB::init();
+
+    return BELETTE_OK;
+}
+
+BeletteEngine *belette_engine_new(size_t hashMb) {
+    BeletteEngine *engine = new BeletteEngine();
+    engine->tt = std::make_unique<TranspositionTable>(hashBytes(hashMb));
+    engine->engine = std::make_unique<LibraryEngine>(*engine->tt);
+
+    return engine;
+}
+
+void belette_engine_free(BeletteEngine *engine) {
+    if (!engine) return;
+
+    engine->engine->stop();
+    engine->engine->waitForSearchFinish();
+    delete engine;
+}
+
+void belette_engine_set_hash(BeletteEngine *engine, size_t hashMb) {
+    engine->engine->waitForSearchFinish();
+    engine->engine->setHashSize(hashBytes(hashMb));
+}
+
+void belette_engine_new_game(BeletteEngine *engine) {
+    engine->engine->waitForSearchFinish();
+    engine->engine->newGame();
+}
+
+void belette_engine_set_callbacks(BeletteEngine *engine, BeletteSearchCallback progress, BeletteSearchCallback finish, void *userData) {
+    engine->engine->progress = progress;
+    engine->engine->finish = finish;
+    engine->engine->userData = userData;
+}
+
+int belette_set_position(BeletteEngine *engine, const char *fen, const char *const *moves, size_t nbMoves) {
+    if (engine->engine->isSearching()) return BELETTE_ERROR_SEARCHING;
+
+    Position &pos = engine->engine->position();
+
+    if (!pos.setFromFEN(fen ? fen : STARTPOS_FEN)) {
+        pos.setFromFEN(STARTPOS_FEN);
+        return BELETTE_ERROR_INVALID_FEN;
+    }
+
+    for (size_t i = 0; i < nbMoves; i++) {
+        Move move = parseMove(pos, moves[i]);
+        if (move == MOVE_NONE) return BELETTE_ERROR_INVALID_MOVE;
+
+        pos.doMove(move);
+    }
+
+    return BELETTE_OK;
+}
+
+size_t belette_get_fen(const BeletteEngine *engine, char *buffer, size_t size) {
+    std::string fen = engine->engine->position().fen();
+    if (buffer && size > 0) copyString(buffer, size, fen);
+
+    return fen.size();
+}
+
+int belette_search(BeletteEngine *engine, const BeletteLimits *limits) {
+    if (engine->engine->isSearching()) return BELETTE_ERROR_SEARCHING;
+
+    engine->engine->search(searchLimits(limits));
+
+    return BELETTE_OK;
+}
+
+int belette_search_sync(BeletteEngine *engine, const BeletteLimits *limits, BeletteSearchInfo *info) {
+    if (engine->engine->isSearching()) return BELETTE_ERROR_SEARCHING;
+
+    engine->engine->searchSync(searchLimits(limits));
+    if (info) *info = engine->engine->result;
+
+    return BELETTE_OK;
+}
+
+void belette_stop(BeletteEngine *engine) {
+    engine->engine->stop();
+}
+
+void belette_wait(BeletteEngine *engine) {
+    engine->engine->waitForSearchFinish();
+}
+
+uint64_t belette_perft(BeletteEngine *engine, int depth) {
+    if (depth <= 0) return 1;
+
+    auto pos = std::make_unique<Position>(engine->engine->position());
+
+    return perft<false>(*pos, depth);
+}
+
+} /* extern "C" */
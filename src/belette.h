@@ -0,0 +1,106 @@
+#ifndef BELETTE_H_INCLUDED
+#define BELETTE_H_INCLUDED
+
+/*
+ * C API of libbelette (make lib), to embed the engine in another process without the UCI protocol
+ *
+ * An engine owns its position and its hash table. Its functions must not be called concurrently, except
+ * belette_stop() which can be called from any thread while a search started by belette_search() is running.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define BELETTE_API __declspec(dllexport)
+#else
+#define BELETTE_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+    BELETTE_OK = 0,
+    BELETTE_ERROR_CPU = -1,          // The cpu doesn't support the instruction set of the library
+    BELETTE_ERROR_INVALID_FEN = -2,
+    BELETTE_ERROR_INVALID_MOVE = -3,
+    BELETTE_ERROR_SEARCHING = -4     // A search is already running
+};
+
+typedef struct BeletteEngine BeletteEngine;
+
+// Limits of a search, fields left to 0 are not used. Without any limit the search runs up to the maximum depth
+// or until belette_stop()
+typedef struct {
+    int depth;
+    uint64_t nodes;
+    int64_t movetime;                // Milliseconds
+    int64_t wtime, btime;            // Clock, the engine allocates its time from it
+    int64_t winc, binc;
+    int movestogo;
+} BeletteLimits;
+
+#define BELETTE_PV_SIZE 1024
+
+// Equivalent of the UCI "info" and "bestmove" lines
+typedef struct {
+    int depth;
+    int seldepth;
+    int score;                       // Centipawns from the side to move point of view
+    int mate;                        // Moves to mate (negative when mated), 0 if the score is not a mate score
+    uint64_t nodes;
+    int64_t time;                    // Milliseconds
+    int hashfull;                    // Per mille
+    char bestmove[8];                // UCI notation, "(none)" without legal moves
+    char ponder[8];                  // Empty if none
+    char pv[BELETTE_PV_SIZE];        // Space separated moves in UCI notation
+} BeletteSearchInfo;
+
+// Called from the search thread (the calling thread for belette_search_sync), info is only valid during the call
+typedef void (*BeletteSearchCallback)(const BeletteSearchInfo *info, void *userData);
+
+BELETTE_API const char *belette_version(void);
+
+// Initialize the attack tables, must be called once before anything else. Returns BELETTE_ERROR_CPU if the cpu
+// is missing an extension used by the library
+BELETTE_API int belette_init(void);
+
+// Hash sizes are in megabytes, at least 1
+BELETTE_API BeletteEngine *belette_engine_new(size_t hashMb);
+BELETTE_API void belette_engine_free(BeletteEngine *engine);
+
+BELETTE_API void belette_engine_set_hash(BeletteEngine *engine, size_t hashMb);
+BELETTE_API void belette_engine_new_game(BeletteEngine *engine);
+
+// progress is called after each iteration, finish once with the final result. Both are optional
+BELETTE_API void belette_engine_set_callbacks(BeletteEngine *engine, BeletteSearchCallback progress,
+                                              BeletteSearchCallback finish, void *userData);
+
+// Set the position from a FEN (NULL for the start position) followed by moves in UCI notation. On an invalid move
+// the position is left after the moves before it
+BELETTE_API int belette_set_position(BeletteEngine *engine, const char *fen, const char *const *moves, size_t nbMoves);
+
+// Write the FEN of the current position to buffer, returns the length of the FEN
+BELETTE_API size_t belette_get_fen(const BeletteEngine *engine, char *buffer, size_t size);
+
+// Start a search in a background thread and return immediately
+BELETTE_API int belette_search(BeletteEngine *engine, const BeletteLimits *limits);
+
+// Search in the calling thread, the final result is also copied to info if not NULL
+BELETTE_API int belette_search_sync(BeletteEngine *engine, const BeletteLimits *limits, BeletteSearchInfo *info);
+
+BELETTE_API void belette_stop(BeletteEngine *engine);
+
+// Wait for the end of the search started by belette_search()
+BELETTE_API void belette_wait(BeletteEngine *engine);
+
+// Number of leaf nodes at the given depth from the current position
+BELETTE_API uint64_t belette_perft(BeletteEngine *engine, int depth);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BELETTE_H_INCLUDED */
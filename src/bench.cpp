@@ -1,10 +1,24 @@
 #include <vector>
+#include <memory>
 #include <chrono>
 #include <thread>
 #include <algorithm>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <cmath>
 #include "bench.h"
 #include "uci.h"
 #include "utils.h"
+#include "stats.h"
+#include "perfcounters.h"
+#include "evaluate.h"
+#include "movegen.h"
+#include "movepicker.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 namespace Belette {
 
@@ -66,6 +80,7 @@ class BenchEngine : public UciEngine {
 public:
     size_t nbNodes = 0;
     TimeMs elapsed = 0;
+    bool printBestMove = true;
 
     size_t nps() { return 1000ull * nbNodes / std::max((uint64_t)elapsed, (uint64_t)1); }
 
@@ -74,7 +89,7 @@ private:
         //UciEngine::onSearchProgress(event);
     }
     virtual void onSearchFinish(const SearchEvent &event) {
-        UciEngine::onSearchFinish(event);
+        if (printBestMove) UciEngine::onSearchFinish(event);
         nbNodes += event.nbNodes;
         elapsed += event.elapsed;
     }
@@ -84,6 +99,10 @@ private:
 void bench(int depth) {
     BenchEngine engine;
 
+#ifdef STATS
+    searchStats.clear();
+#endif
+
     for (auto fen : BENCH_POSITIONS) {
         SearchLimits limits;
         limits.maxDepth = depth;
@@ -100,6 +119,521 @@ void bench(int depth) {
     console << std::endl << "-----------------------------" << std::endl;
     console << "Elapsed: " << engine.elapsed << std::endl;
     console << engine.nbNodes << " nodes " << engine.nps() << " nps" << std::endl;
+
+#ifdef STATS
+    searchStats.print();
+#endif
+}
+
+static void reportPerf(const PerfCounters &counters, const uint64_t values[NB_PERF_EVENT], size_t nbNodes) {
+    double kiloNodes = std::max<size_t>(nbNodes, 1) / 1000.0;
+
+    console << std::fixed << std::setprecision(2);
+
+    if (counters.isAvailable(PERF_CYCLES))
+        console << " cycles/node " << values[PERF_CYCLES] / (kiloNodes * 1000.0);
+
+    if (counters.isAvailable(PERF_CYCLES) && counters.isAvailable(PERF_INSTRUCTIONS))
+        console << " IPC " << double(values[PERF_INSTRUCTIONS]) / std::max<uint64_t>(values[PERF_CYCLES], 1);
+
+    for (PerfEvent event : {PERF_BRANCH_MISSES, PERF_L1D_MISSES, PERF_LLC_MISSES, PERF_DTLB_MISSES}) {
+        if (counters.isAvailable(event))
+            console << " " << PerfCounters::name(event) << "/kn " << values[event] / kiloNodes;
+    }
+
+    console << std::endl;
+}
+
+void benchPerf(int depth) {
+    BenchEngine engine;
+    PerfCounters counters;
+    engine.printBestMove = false;
+
+    if (!counters.isAvailable()) {
+        console << "Performance counters are not available (Linux only, see /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+        return;
+    }
+
+    console << "Counters:";
+    for (int event = 0; event < NB_PERF_EVENT; event++) {
+        console << " " << PerfCounters::name(PerfEvent(event)) << (counters.isAvailable(PerfEvent(event)) ? "" : " (n/a)");
+    }
+    console << std::endl;
+
+    uint64_t total[NB_PERF_EVENT] = {};
+    int index = 0;
+
+    for (auto fen : BENCH_POSITIONS) {
+        SearchLimits limits;
+        limits.maxDepth = depth;
+
+        engine.newGame();
+        engine.position().setFromFEN(fen);
+
+        size_t nodesBefore = engine.nbNodes;
+
+        // The search runs in this thread, counters only measure the calling thread
+        counters.start();
+        engine.searchSync(limits);
+        counters.stop();
+
+        uint64_t values[NB_PERF_EVENT];
+        for (int event = 0; event < NB_PERF_EVENT; event++) {
+            values[event] = counters.value(PerfEvent(event));
+            total[event] += values[event];
+        }
+
+        size_t nbNodes = engine.nbNodes - nodesBefore;
+        console << std::setw(2) << ++index << " nodes " << nbNodes;
+        reportPerf(counters, values, nbNodes);
+    }
+
+    console << std::endl << "-----------------------------" << std::endl;
+    console << "Elapsed: " << engine.elapsed << std::endl;
+    console << engine.nbNodes << " nodes " << engine.nps() << " nps" << std::endl;
+    console << "Total:";
+    reportPerf(counters, total, engine.nbNodes);
+}
+
+struct SampleStats {
+    size_t count = 0;
+    double mean = 0, median = 0, stddev = 0, ci95 = 0; // ci95 is the half width of the interval of the mean
+};
+
+// Two-sided 95% critical value of the Student t distribution
+static double studentT95(double df) {
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+
+    if (df < 1) return table[0];
+    if (df > 30) return 1.96;
+    return table[int(df) - 1];
+}
+
+static SampleStats computeStats(std::vector<double> samples) {
+    SampleStats stats;
+    stats.count = samples.size();
+    if (samples.empty()) return stats;
+
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+
+    stats.median = n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+
+    for (double x : samples) stats.mean += x;
+    stats.mean /= n;
+
+    if (n > 1) {
+        for (double x : samples) stats.stddev += (x - stats.mean) * (x - stats.mean);
+        stats.stddev = std::sqrt(stats.stddev / (n - 1));
+        stats.ci95 = studentT95(n - 1) * stats.stddev / std::sqrt(double(n));
+    }
+
+    return stats;
+}
+
+static void reportStats(const char* name, const SampleStats &stats) {
+    console << std::fixed << std::setprecision(0)
+            << name << " median " << stats.median << " mean " << stats.mean
+            << " stddev " << stats.stddev << std::setprecision(2) << " (" << (stats.mean > 0 ? 100.0 * stats.stddev / stats.mean : 0.0) << "%)"
+            << std::setprecision(0) << " 95% CI +/- " << stats.ci95 << std::endl;
+}
+
+static bool pinToCpu(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    return sched_setaffinity(0, sizeof(set), &set) == 0; // Calling thread
+#else
+    return false;
+#endif
+}
+
+void benchRuns(const BenchParams &params) {
+    struct Run { size_t nodes; int64_t timeUs; double nps; };
+
+    if (params.cpu >= 0 && !pinToCpu(params.cpu)) {
+        console << "Unable to pin to cpu " << params.cpu << std::endl;
+    }
+
+    BenchEngine engine;
+    engine.printBestMove = false;
+
+    std::vector<Run> runs;
+
+    for (int i = 0; i < params.warmup + params.runs; i++) {
+        Run run = {0, 0, 0.0};
+
+        for (auto fen : BENCH_POSITIONS) {
+            SearchLimits limits;
+            limits.maxDepth = params.depth;
+
+            engine.newGame();
+            engine.position().setFromFEN(fen);
+
+            size_t nodesBefore = engine.nbNodes;
+            auto start = std::chrono::steady_clock::now();
+
+            engine.searchSync(limits);
+
+            run.timeUs += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+            run.nodes += engine.nbNodes - nodesBefore;
+        }
+
+        run.nps = 1e6 * run.nodes / std::max<int64_t>(run.timeUs, 1);
+
+        bool isWarmup = i < params.warmup;
+        console << (isWarmup ? "Warmup " : "Run ") << (isWarmup ? i + 1 : i - params.warmup + 1) << ": "
+                << run.nodes << " nodes " << run.timeUs / 1000 << " ms " << size_t(run.nps) << " nps" << std::endl;
+
+        if (!isWarmup) runs.push_back(run);
+    }
+
+    std::vector<double> nps, times;
+    for (auto &run : runs) {
+        nps.push_back(run.nps);
+        times.push_back(run.timeUs / 1000.0);
+    }
+
+    SampleStats npsStats = computeStats(nps), timeStats = computeStats(times);
+
+    console << std::endl << "-----------------------------" << std::endl;
+    if (!runs.empty()) console << runs.front().nodes << " nodes" << std::endl;
+    reportStats("NPS:", npsStats);
+    reportStats("Time (ms):", timeStats);
+
+    if (!params.jsonFile.empty()) {
+        std::ofstream file(params.jsonFile);
+        file << std::fixed << std::setprecision(1);
+        file << "{\"depth\":" << params.depth << ",\"positions\":" << BENCH_POSITIONS.size()
+             << ",\"warmup\":" << params.warmup << ",\"nodes\":" << (runs.empty() ? 0 : runs.front().nodes) << ",\"runs\":[";
+
+        for (size_t i = 0; i < runs.size(); i++) {
+            file << (i ? "," : "") << "{\"time_us\":" << runs[i].timeUs << ",\"nps\":" << runs[i].nps << "}";
+        }
+
+        file << "],\"summary\":{\"median\":" << npsStats.median << ",\"mean\":" << npsStats.mean
+             << ",\"stddev\":" << npsStats.stddev << ",\"ci95\":" << npsStats.ci95 << "}}" << std::endl;
+
+        if (!file) console << "Unable to write '" << params.jsonFile << "'" << std::endl;
+    }
+
+    if (!params.csvFile.empty()) {
+        std::ofstream file(params.csvFile);
+        file << std::fixed << std::setprecision(1) << "run,nodes,time_us,nps" << std::endl;
+
+        for (size_t i = 0; i < runs.size(); i++) {
+            file << i + 1 << "," << runs[i].nodes << "," << runs[i].timeUs << "," << runs[i].nps << std::endl;
+        }
+
+        if (!file) console << "Unable to write '" << params.csvFile << "'" << std::endl;
+    }
+}
+
+// NPS samples of a result file, JSON files are recognized by their first character
+static bool loadBenchSamples(const std::string &filename, std::vector<double> &samples) {
+    std::ifstream file(filename);
+    if (!file.is_open()) return false;
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    std::string content = buffer.str();
+
+    if (content.starts_with("{")) {
+        const std::string key = "\"nps\":";
+        for (size_t pos = content.find(key); pos != std::string::npos; pos = content.find(key, pos + 1)) {
+            std::istringstream is(content.substr(pos + key.size(), 32));
+            double nps;
+            if (is >> nps) samples.push_back(nps);
+        }
+    } else {
+        std::istringstream is(content);
+        std::string line;
+        std::getline(is, line); // Header
+
+        while (std::getline(is, line)) {
+            size_t sep = line.rfind(',');
+            if (sep != std::string::npos) samples.push_back(parseDouble(line.substr(sep + 1)));
+        }
+    }
+
+    return !samples.empty();
+}
+
+void benchCompare(const std::string &baseFile, const std::string &newFile) {
+    std::vector<double> baseSamples, newSamples;
+
+    if (!loadBenchSamples(baseFile, baseSamples) || !loadBenchSamples(newFile, newSamples)) {
+        console << "Unable to load bench results from '" << baseFile << "' and '" << newFile << "'" << std::endl;
+        return;
+    }
+
+    SampleStats base = computeStats(baseSamples), test = computeStats(newSamples);
+
+    reportStats("Base NPS:", base);
+    reportStats("New NPS: ", test);
+
+    // Welch's t-test on the mean NPS
+    double varBase = base.stddev * base.stddev / base.count, varTest = test.stddev * test.stddev / test.count;
+    double se = std::sqrt(varBase + varTest);
+    double dfDenominator = (base.count > 1 ? varBase * varBase / (base.count - 1) : 0) + (test.count > 1 ? varTest * varTest / (test.count - 1) : 0);
+    double df = dfDenominator > 0 ? (varBase + varTest) * (varBase + varTest) / dfDenominator : 1;
+    double diff = test.mean - base.mean;
+    double margin = studentT95(df) * se;
+
+    console << std::fixed << std::setprecision(2)
+            << "Speedup: " << 100.0 * diff / base.mean << "% +/- " << 100.0 * margin / base.mean << "% (95% CI)"
+            << " t = " << (se > 0 ? diff / se : 0.0) << std::endl;
+
+    if (base.count < 2 || test.count < 2)
+        console << "Not enough runs to test significance" << std::endl;
+    else if (std::abs(diff) > margin)
+        console << (diff > 0 ? "Significant speedup" : "Significant slowdown") << std::endl;
+    else
+        console << "No significant difference" << std::endl;
+}
+
+template<typename Eval>
+static double timeEval(const std::vector<Position> &positions, int iterations, Eval eval, int64_t &checksum) {
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; i++) {
+        for (auto &pos : positions) checksum += eval(pos);
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    return double(elapsed) / (double(iterations) * positions.size());
+}
+
+// Bench positions and all their children, to get a mix of material and sides to move
+static std::vector<Position> benchPositionsWithChildren() {
+    std::vector<Position> positions;
+    for (auto fen : BENCH_POSITIONS) {
+        Position pos;
+        pos.setFromFEN(fen);
+        positions.push_back(pos);
+
+        enumerateLegalMoves(pos, [&](Move m) {
+            Position child = pos;
+            child.doMove(m);
+            positions.push_back(child);
+            return true;
+        });
+    }
+
+    return positions;
+}
+
+void benchEval(int iterations) {
+    std::vector<Position> positions = benchPositionsWithChildren();
+
+    size_t mismatches = 0;
+    for (auto &pos : positions) {
+        if (evaluate(pos) != evaluateReference(pos)) mismatches++;
+    }
+
+    int64_t checksum = 0;
+    double referenceNs = timeEval(positions, iterations, [](const Position &pos) { return evaluateReference(pos); }, checksum);
+    double packedNs = timeEval(positions, iterations, [](const Position &pos) { return evaluate(pos); }, checksum);
+
+    console << positions.size() << " positions x " << iterations << " iterations (checksum " << checksum << ")" << std::endl;
+    console << std::fixed << std::setprecision(2) << "Reference: " << referenceNs << " ns/eval" << std::endl;
+    console << std::fixed << std::setprecision(2) << "Packed:    " << packedNs << " ns/eval" << std::endl;
+    console << std::fixed << std::setprecision(2) << "Speedup:   " << referenceNs / packedNs << "x" << std::endl;
+    console << "Mismatches: " << mismatches << std::endl;
+}
+
+static int enumerateCount(const Position &pos) {
+    int count = 0;
+    enumerateLegalMoves(pos, [&](Move) { count++; return true; });
+    return count;
+}
+
+static bool enumerateAny(const Position &pos) {
+    return !enumerateLegalMoves(pos, [](Move) { return false; });
+}
+
+void benchMoveCount(int iterations) {
+    std::vector<Position> positions = benchPositionsWithChildren();
+
+    size_t mismatches = 0;
+    for (auto &pos : positions) {
+        if (countLegalMoves(pos) != enumerateCount(pos) || hasLegalMove(pos) != enumerateAny(pos)) mismatches++;
+    }
+
+    int64_t checksum = 0;
+    double enumerateCountNs = timeEval(positions, iterations, [](const Position &pos) { return enumerateCount(pos); }, checksum);
+    double countNs = timeEval(positions, iterations, [](const Position &pos) { return countLegalMoves(pos); }, checksum);
+    double enumerateAnyNs = timeEval(positions, iterations, [](const Position &pos) { return int(enumerateAny(pos)); }, checksum);
+    double anyNs = timeEval(positions, iterations, [](const Position &pos) { return int(hasLegalMove(pos)); }, checksum);
+
+    console << positions.size() << " positions x " << iterations << " iterations (checksum " << checksum << ")" << std::endl;
+    console << std::fixed << std::setprecision(2) << "Enumerate count:  " << enumerateCountNs << " ns/position" << std::endl;
+    console << std::fixed << std::setprecision(2) << "countLegalMoves:  " << countNs << " ns/position (" << enumerateCountNs / countNs << "x)" << std::endl;
+    console << std::fixed << std::setprecision(2) << "Enumerate any:    " << enumerateAnyNs << " ns/position" << std::endl;
+    console << std::fixed << std::setprecision(2) << "hasLegalMove:     " << anyNs << " ns/position (" << enumerateAnyNs / anyNs << "x)" << std::endl;
+    console << "Mismatches: " << mismatches << std::endl;
+}
+
+// Quiet moves of a position with a history filled from them, to score them like the MovePicker does
+struct QuietScoringCase {
+    Position pos;
+    std::vector<ScoredMove> moves;
+};
+
+template<Side Me>
+static void scoreQuietsScalar(MovePicker &mp, std::vector<ScoredMove> &moves) {
+    for (auto &m : moves) m.score = mp.scoreQuiet<Me>(m.move);
+}
+
+template<Side Me>
+static void scoreQuietsBatched(MovePicker &mp, std::vector<ScoredMove> &moves) {
+    mp.scoreQuiets<Me>(moves.data(), moves.data() + moves.size());
+}
+
+void benchMovePicker(int iterations) {
+    std::vector<QuietScoringCase> cases;
+    auto history = std::make_unique<MoveHistory>();
+    auto arena = std::make_unique<MoveArena>();
+
+    for (auto &pos : benchPositionsWithChildren()) {
+        if (pos.inCheck()) continue;
+
+        QuietScoringCase c{pos, {}};
+        PartialMoveList quiets;
+        enumerateLegalMoves<QUIET_MOVES>(pos, [&](Move m) {
+            c.moves.push_back(ScoredMove(m, 0));
+            if (quiets.size() < quiets.capacity()) quiets.push_back(m);
+            return true;
+        });
+
+        if (c.moves.empty()) continue;
+
+        // Make the first quiet a good move and the other ones bad
+        quiets.erase(quiets.begin());
+        pos.getSideToMove() == WHITE ? history->update<WHITE>(pos, c.moves.front().move, 0, 8, quiets)
+                                     : history->update<BLACK>(pos, c.moves.front().move, 0, 8, quiets);
+        cases.push_back(c);
+    }
+
+    size_t nbMoves = 0, mismatches = 0;
+    for (auto &c : cases) {
+        MovePicker mp(c.pos, *arena, MOVE_NONE, history.get(), 0);
+        std::vector<ScoredMove> scalar = c.moves, batched = c.moves;
+
+        c.pos.getSideToMove() == WHITE ? scoreQuietsScalar<WHITE>(mp, scalar) : scoreQuietsScalar<BLACK>(mp, scalar);
+        c.pos.getSideToMove() == WHITE ? scoreQuietsBatched<WHITE>(mp, batched) : scoreQuietsBatched<BLACK>(mp, batched);
+
+        nbMoves += c.moves.size();
+        for (size_t i = 0; i < scalar.size(); i++) mismatches += scalar[i].score != batched[i].score;
+    }
+
+    auto timeScoring = [&](bool batched) {
+        int64_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < iterations; i++) {
+            for (auto &c : cases) {
+                MovePicker mp(c.pos, *arena, MOVE_NONE, history.get(), 0);
+
+                if (c.pos.getSideToMove() == WHITE)
+                    batched ? scoreQuietsBatched<WHITE>(mp, c.moves) : scoreQuietsScalar<WHITE>(mp, c.moves);
+                else
+                    batched ? scoreQuietsBatched<BLACK>(mp, c.moves) : scoreQuietsScalar<BLACK>(mp, c.moves);
+
+                checksum += c.moves.front().score;
+            }
+        }
+
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        return std::make_pair(double(elapsed) / (double(iterations) * nbMoves), checksum);
+    };
+
+    auto [scalarNs, scalarChecksum] = timeScoring(false);
+    auto [batchedNs, batchedChecksum] = timeScoring(true);
+
+    console << cases.size() << " positions, " << nbMoves << " quiet moves x " << iterations << " iterations" << std::endl;
+    console << std::fixed << std::setprecision(2) << "Scalar:  " << scalarNs << " ns/move" << std::endl;
+    console << std::fixed << std::setprecision(2) << "Batched: " << batchedNs << " ns/move" << std::endl;
+    console << std::fixed << std::setprecision(2) << "Speedup: " << scalarNs / batchedNs << "x" << std::endl;
+    console << "Mismatches: " << mismatches + (scalarChecksum != batchedChecksum) << std::endl;
+}
+
+class GameReplayEngine : public Engine {
+public:
+    Move bestMove = MOVE_NONE;
+    size_t nbNodes = 0;
+    std::vector<size_t> iterationNodes; // Nodes at the end of each iteration of the last search
+
+private:
+    virtual void onSearchProgress(const SearchEvent &event) {
+        if (event.depth > int(iterationNodes.size())) iterationNodes.push_back(event.nbNodes);
+    }
+    virtual void onSearchFinish(const SearchEvent &event) {
+        bestMove = event.pv.empty() ? MOVE_NONE : event.pv.front();
+        nbNodes = event.nbNodes;
+    }
+};
+
+struct GameReplayResult {
+    size_t nbNodes = 0;
+    size_t earlyNodes = 0; // Nodes of the first half of the iterations
+};
+
+// Last iteration counted in GameReplayResult::earlyNodes
+static int earlyDepth(int depth) { return std::max(1, depth / 2); }
+
+// Search every position of a game from the start position. The moves of the game are played if given,
+// otherwise the best moves are played and recorded
+static GameReplayResult replayGame(std::vector<Move> &moves, int depth, int nbPlies, int historyDecay) {
+    GameReplayResult result;
+    auto engine = std::make_unique<GameReplayEngine>();
+    bool record = moves.empty();
+
+    SearchLimits limits;
+    limits.maxDepth = depth;
+
+    engine->setHistoryDecay(historyDecay);
+    engine->newGame();
+    engine->position().setFromFEN(STARTPOS_FEN);
+
+    for (int ply = 0; ply < nbPlies; ply++) {
+        engine->iterationNodes.clear();
+        engine->searchSync(limits);
+
+        if (record && engine->bestMove != MOVE_NONE) moves.push_back(engine->bestMove);
+        if (ply >= int(moves.size())) break;
+
+        result.nbNodes += engine->nbNodes;
+        if (!engine->iterationNodes.empty())
+            result.earlyNodes += engine->iterationNodes[std::min<size_t>(earlyDepth(depth), engine->iterationNodes.size()) - 1];
+
+        engine->position().doMove(moves[ply]);
+    }
+
+    return result;
+}
+
+void benchGame(int depth, int nbPlies, const std::vector<int> &decays) {
+    std::vector<Move> moves;
+    GameReplayResult cleared = replayGame(moves, depth, nbPlies, 0);
+
+    console << moves.size() << " plies at depth " << depth << std::endl;
+    console << "History cleared: " << cleared.nbNodes << " nodes, " << cleared.earlyNodes << " up to depth " << earlyDepth(depth) << std::endl;
+
+    for (int decay : decays) {
+        GameReplayResult kept = replayGame(moves, depth, nbPlies, decay);
+
+        console << "Decay " << decay << ": " << kept.nbNodes << " nodes, " << kept.earlyNodes << " up to depth " << earlyDepth(depth)
+                << std::fixed << std::setprecision(1)
+                << " (" << 100.0 * (double(kept.nbNodes) / cleared.nbNodes - 1) << "%, "
+                << 100.0 * (double(kept.earlyNodes) / cleared.earlyNodes - 1) << "%)" << std::endl;
+    }
 }
 
 } /* namespace Belette  */
\ No newline at end of file
@@ -1,11 +1,45 @@
 #ifndef BENCH_H_INCLUDED
 #define BENCH_H_INCLUDED
 
+#include <string>
+#include <vector>
+
 namespace Belette {
 
 constexpr int DEFAULT_BENCH_DEPTH = 15;
 
+struct BenchParams {
+    int depth = DEFAULT_BENCH_DEPTH;
+    int runs = 5;
+    int warmup = 1; // Runs discarded before measuring
+    int cpu = -1; // Pin the bench to this cpu if >= 0 (Linux only)
+    std::string jsonFile;
+    std::string csvFile;
+};
+
 void bench(int depth);
+
+// Bench with hardware performance counters (Linux only), reports IPC, cycles per node and misses per kilonode
+void benchPerf(int depth);
+
+// Repeated bench runs with median, standard deviation and 95% confidence interval of the NPS
+void benchRuns(const BenchParams &params);
+
+// Evaluation microbenchmark, times evaluate() against evaluateReference() on the bench positions and their children
+void benchEval(int iterations);
+
+// Times countLegalMoves() and hasLegalMove() against counting with enumerateLegalMoves() on the same positions
+void benchMoveCount(int iterations);
+
+// Times the batched (AVX2) scoring of quiet moves against scoring them one by one, on the bench positions and their children
+void benchMovePicker(int iterations);
+
+// Searches the positions of a self played game clearing the history before each search, then keeping it with each
+// of the decays, and compares the node counts
+void benchGame(int depth, int nbPlies, const std::vector<int> &decays);
+
+// Compare two result files written by benchRuns (JSON or CSV) and report if the speedup is significant
+void benchCompare(const std::string &baseFile, const std::string &newFile);
     
 } /* namespace Belette */
 
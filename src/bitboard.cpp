@@ -3,21 +3,10 @@
 
 namespace Belette {
 
-Bitboard PAWN_ATTACK[NB_SIDE][NB_SQUARE];
-Bitboard KNIGHT_MOVE[NB_SQUARE];
-Bitboard KING_MOVE[NB_SQUARE];
-PextEntry ROOK_MOVE[NB_SQUARE];
-PextEntry BISHOP_MOVE[NB_SQUARE];
-
-Bitboard BETWEEN_BB[NB_SQUARE][NB_SQUARE];
-
-Bitboard ROOK_DATA[0x19000];
-Bitboard BISHOP_DATA[0x1480];
-
 namespace BB {
 
 template<Direction Dir>
-inline Bitboard slidingRay(Square sq, Bitboard occupied) 
+constexpr Bitboard slidingRay(Square sq, Bitboard occupied)
 {
     Bitboard attacks = 0;
     Bitboard b = (1ULL << sq);
@@ -30,45 +19,209 @@ inline Bitboard slidingRay(Square sq, Bitboard occupied)
 }
 
 template<PieceType Pt>
-Bitboard slidingAttacks(Square sq, Bitboard occupied) 
+constexpr Bitboard slidingAttacks(Square sq, Bitboard occupied)
 {
     if constexpr (Pt == ROOK)
-        return slidingRay<UP>(sq, occupied) 
-            | slidingRay<DOWN>(sq, occupied) 
-            | slidingRay<RIGHT>(sq, occupied) 
+        return slidingRay<UP>(sq, occupied)
+            | slidingRay<DOWN>(sq, occupied)
+            | slidingRay<RIGHT>(sq, occupied)
             | slidingRay<LEFT>(sq, occupied);
     else
-        return slidingRay<UP_RIGHT>(sq, occupied) 
-            | slidingRay<UP_LEFT>(sq, occupied) 
-            | slidingRay<DOWN_RIGHT>(sq, occupied) 
+        return slidingRay<UP_RIGHT>(sq, occupied)
+            | slidingRay<UP_LEFT>(sq, occupied)
+            | slidingRay<DOWN_RIGHT>(sq, occupied)
             | slidingRay<DOWN_LEFT>(sq, occupied);
 }
 
+// Relevant occupancy of a slider, edges do not change attacks
+template<PieceType Pt>
+constexpr Bitboard slidingMask(Square s) {
+    Bitboard edges = ((Rank1BB | Rank8BB) & ~bb(rankOf(s))) | ((FileABB | FileHBB) & ~bb(fileOf(s)));
+    return slidingAttacks<Pt>(s, 0) & ~edges;
+}
+
+template<size_t Size>
+struct SliderTable {
+    std::array<Bitboard, Size> data;
+    std::array<unsigned, NB_SQUARE> offsets;
+};
+
+#ifdef USE_PEXT
+template<PieceType Pt, size_t Size>
+constexpr SliderTable<Size> makeSliderTable() {
+    SliderTable<Size> table{};
+    unsigned size = 0;
+
+    for (Square s=SQ_A1; s<NB_SQUARE; ++s) {
+        Bitboard mask = slidingMask<Pt>(s);
+        table.offsets[s] = s == SQ_A1 ? 0 : table.offsets[s - 1] + size;
+
+        // Enumerate all subsets of the mask (Carry-Rippler)
+        size = 0;
+        Bitboard b = 0;
+        do {
+            table.data[table.offsets[s] + pext(b, mask)] = slidingAttacks<Pt>(s, b);
+
+            size++;
+            b = (b - mask) & mask;
+        } while (b);
+    }
+
+    return table;
+}
+
+template<PieceType Pt, size_t Size>
+constexpr std::array<SliderEntry, NB_SQUARE> makeSliderEntries(const SliderTable<Size> &table) {
+    std::array<SliderEntry, NB_SQUARE> entries{};
 
+    for (Square s=SQ_A1; s<NB_SQUARE; ++s) {
+        entries[s].mask = slidingMask<Pt>(s);
+        entries[s].data = table.data.data() + table.offsets[s];
+    }
+
+    return entries;
+}
+
+#else
+
+// Random numbers with few bits set for magic candidates (xorshift64*)
+class MagicPRNG {
+public:
+    MagicPRNG(uint64_t seed): s(seed) { }
 
+    inline uint64_t rand() {
+        s ^= s >> 12, s ^= s << 25, s ^= s >> 27;
+        return s * 2685821657736338717ULL;
+    }
+
+    inline uint64_t sparseRand() { return rand() & rand() & rand(); }
+
+private:
+    uint64_t s;
+};
+
+// Find a magic number for each square and fill the attack tables
 template<PieceType Pt>
-void init_pext(Bitboard table[], PextEntry magics[]) {
+void init_magics(Bitboard table[], SliderEntry entries[]) {
+    constexpr uint64_t seeds[NB_RANK] = { 728, 10316, 55013, 32803, 12281, 15100, 16645, 255 }; // Seeds known to find magics quickly
+    Bitboard occupancy[4096], reference[4096];
+    int epoch[4096] = {}, attempt = 0;
     int size = 0;
 
-    for (int i=0; i<NB_SQUARE; i++) {
-        Square s = Square(i);
-
-        Bitboard edges = ((Rank1BB | Rank8BB) & ~bb(rankOf(s))) | ((FileABB | FileHBB) & ~bb(fileOf(s)));
+    for (Square s=SQ_A1; s<NB_SQUARE; ++s) {
+        SliderEntry& m = entries[s];
+        Bitboard *data = s == SQ_A1 ? table : const_cast<Bitboard *>(entries[s - 1].data) + size;
 
-        PextEntry& m = magics[s];
-        m.mask  = slidingAttacks<Pt>(s, 0) & ~edges;
-        m.data = s == SQ_A1 ? table : magics[s - 1].data + size;
+        m.mask = slidingMask<Pt>(s);
+        m.data = data;
+        m.shift = 64 - popcount(m.mask);
 
+        // Enumerate all subsets of the mask (Carry-Rippler)
         size = 0;
         Bitboard b = 0;
         do {
-            m.data[pext(b, m.mask)] = slidingAttacks<Pt>(s, b);
+            occupancy[size] = b;
+            reference[size] = slidingAttacks<Pt>(s, b);
 
             size++;
             b = (b - m.mask) & m.mask;
         } while (b);
+
+        MagicPRNG rng(seeds[rankOf(s)]);
+
+        // Try random magics until one maps every subset without destructive collision
+        for (int j = 0; j < size; ) {
+            for (m.magic = 0; popcount((m.magic * m.mask) >> 56) < 6; )
+                m.magic = rng.sparseRand();
+
+            for (++attempt, j = 0; j < size; ++j) {
+                unsigned idx = m.index(occupancy[j]);
+
+                if (epoch[idx] < attempt) {
+                    epoch[idx] = attempt;
+                    data[idx] = reference[j];
+                } else if (data[idx] != reference[j]) {
+                    break;
+                }
+            }
+        }
     }
 }
+#endif
+
+} // namespace BB
+
+constexpr std::array<std::array<Bitboard, NB_SQUARE>, NB_SIDE> PAWN_ATTACK = [] {
+    std::array<std::array<Bitboard, NB_SQUARE>, NB_SIDE> table{};
+
+    for (Square s=SQ_A1; s<NB_SQUARE; ++s) {
+        table[WHITE][s] = shift<UP_LEFT>(bb(s)) | shift<UP_RIGHT>(bb(s));
+        table[BLACK][s] = shift<DOWN_RIGHT>(bb(s)) | shift<DOWN_LEFT>(bb(s));
+    }
+
+    return table;
+}();
+
+constexpr std::array<Bitboard, NB_SQUARE> KNIGHT_MOVE = [] {
+    std::array<Bitboard, NB_SQUARE> table{};
+
+    for (Square s=SQ_A1; s<NB_SQUARE; ++s) {
+        Bitboard b = bb(s);
+
+        table[s] = shift<UP_LEFT>( shift<UP>(b) ) | shift<UP_RIGHT>( shift<UP>(b) )
+                 | shift<UP_RIGHT>( shift<RIGHT>(b) ) | shift<DOWN_RIGHT>( shift<RIGHT>(b) )
+                 | shift<DOWN_RIGHT>( shift<DOWN>(b) ) | shift<DOWN_LEFT>( shift<DOWN>(b) )
+                 | shift<DOWN_LEFT>( shift<LEFT>(b) ) | shift<UP_LEFT>( shift<LEFT>(b) )
+                 ;
+    }
+
+    return table;
+}();
+
+constexpr std::array<Bitboard, NB_SQUARE> KING_MOVE = [] {
+    std::array<Bitboard, NB_SQUARE> table{};
+
+    for (Square s=SQ_A1; s<NB_SQUARE; ++s) {
+        Bitboard b = bb(s);
+
+        table[s] = shift<UP>(b) | shift<DOWN>(b) | shift<RIGHT>(b) | shift<LEFT>(b)
+                 | shift<UP_RIGHT>(b) | shift<UP_LEFT>(b) | shift<DOWN_RIGHT>(b) | shift<DOWN_LEFT>(b);
+    }
+
+    return table;
+}();
+
+constexpr std::array<std::array<Bitboard, NB_SQUARE>, NB_SQUARE> BETWEEN_BB = [] {
+    std::array<std::array<Bitboard, NB_SQUARE>, NB_SQUARE> table{};
+
+    for (Square s=SQ_A1; s<NB_SQUARE; ++s) {
+        for (Square s2=SQ_A1; s2<NB_SQUARE; ++s2) {
+            if (BB::slidingAttacks<ROOK>(s, 0) & s2) {
+                table[s][s2] = BB::slidingAttacks<ROOK>(s, bb(s2)) & BB::slidingAttacks<ROOK>(s2, bb(s));
+            } else if (BB::slidingAttacks<BISHOP>(s, 0) & s2) {
+                table[s][s2] = BB::slidingAttacks<BISHOP>(s, bb(s2)) & BB::slidingAttacks<BISHOP>(s2, bb(s));
+            }
+        }
+    }
+
+    return table;
+}();
+
+#ifdef USE_PEXT
+constexpr auto ROOK_TABLE = BB::makeSliderTable<ROOK, 0x19000>();
+constexpr auto BISHOP_TABLE = BB::makeSliderTable<BISHOP, 0x1480>();
+
+constexpr std::array<SliderEntry, NB_SQUARE> ROOK_MOVE = BB::makeSliderEntries<ROOK>(ROOK_TABLE);
+constexpr std::array<SliderEntry, NB_SQUARE> BISHOP_MOVE = BB::makeSliderEntries<BISHOP>(BISHOP_TABLE);
+#else
+Bitboard ROOK_DATA[0x19000];
+Bitboard BISHOP_DATA[0x1480];
+
+std::array<SliderEntry, NB_SQUARE> ROOK_MOVE;
+std::array<SliderEntry, NB_SQUARE> BISHOP_MOVE;
+#endif
+
+namespace BB {
 
 void debug(Bitboard bb)
 {
@@ -86,41 +239,15 @@ void debug(Bitboard bb)
 	std::cout << std::endl;
 }
 
-
-
 void init()
 {
-    for (Square s=SQ_A1; s<NB_SQUARE; ++s) {
-        Bitboard b = bb(s);
-
-        PAWN_ATTACK[WHITE][s] = shift<UP_LEFT>(b) | shift<UP_RIGHT>(b);
-        PAWN_ATTACK[BLACK][s] = shift<DOWN_RIGHT>(b) | shift<DOWN_LEFT>(b);
-
-        KING_MOVE[s] = shift<UP>(b) | shift<DOWN>(b) | shift<RIGHT>(b) | shift<LEFT>(b)
-                     | shift<UP_RIGHT>(b) | shift<UP_LEFT>(b) | shift<DOWN_RIGHT>(b) | shift<DOWN_LEFT>(b);
-
-        KNIGHT_MOVE[s] = shift<UP_LEFT>( shift<UP>(b) ) | shift<UP_RIGHT>( shift<UP>(b) )
-                       | shift<UP_RIGHT>( shift<RIGHT>(b) ) | shift<DOWN_RIGHT>( shift<RIGHT>(b) )
-                       | shift<DOWN_RIGHT>( shift<DOWN>(b) ) | shift<DOWN_LEFT>( shift<DOWN>(b) )
-                       | shift<DOWN_LEFT>( shift<LEFT>(b) ) | shift<UP_LEFT>( shift<LEFT>(b) )
-                       ;
-
-        for(Square s2=SQ_A1; s2<NB_SQUARE; ++s2) {
-            Bitboard b2 = bb(s2);
-
-            if (slidingAttacks<ROOK>(s, 0) & s2) {
-                BETWEEN_BB[s][s2] |= slidingAttacks<ROOK>(s, b2) & slidingAttacks<ROOK>(s2, b);
-            } else if (slidingAttacks<BISHOP>(s, 0) & s2) {
-                BETWEEN_BB[s][s2] = slidingAttacks<BISHOP>(s, b2) & slidingAttacks<BISHOP>(s2, b);
-            }
-        }
-    }
-
-    init_pext<ROOK>(ROOK_DATA, ROOK_MOVE);
-    init_pext<BISHOP>(BISHOP_DATA, BISHOP_MOVE);
+#ifndef USE_PEXT
+    init_magics<ROOK>(ROOK_DATA, ROOK_MOVE.data());
+    init_magics<BISHOP>(BISHOP_DATA, BISHOP_MOVE.data());
+#endif
 }
 
 } // namespace Bitboard
 
 
-} /* namespace Belette */
\ No newline at end of file
+} /* namespace Belette */
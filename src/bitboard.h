@@ -3,6 +3,8 @@
 
 #include <immintrin.h>
 #include <cassert>
+#include <array>
+#include <type_traits>
 #include "chess.h"
 
 namespace Belette {
@@ -15,9 +17,29 @@ void init();
 
 } // namespace Bitboard
 
-inline uint64_t pext(uint64_t b, uint64_t m) {
+// Slider attacks use PEXT on BMI2 builds and fancy magic bitboards otherwise.
+// USE_MAGIC forces magics, pext is microcoded and very slow on AMD Zen 1/Zen 2
+#if defined(__BMI2__) && !defined(USE_MAGIC)
+#define USE_PEXT
+#endif
+
+#ifdef USE_PEXT
+constexpr const char* SLIDER_ATTACKS = "pext";
+
+constexpr uint64_t pext(uint64_t b, uint64_t m) {
+    if (std::is_constant_evaluated()) { // Used to generate the attack tables at compile time
+        uint64_t result = 0;
+        for (uint64_t bit = 1; m; bit <<= 1, m &= m - 1) {
+            if (b & m & -m) result |= bit;
+        }
+        return result;
+    }
+
     return _pext_u64(b, m);
 }
+#else
+constexpr const char* SLIDER_ATTACKS = "magic";
+#endif
 
 inline int popcount(Bitboard b) {
     return __builtin_popcountll(b);
@@ -34,22 +56,40 @@ inline Square bitscan(Bitboard b) {
 #define bitscan_loop(B) for(; B; B &= B - 1)
 //#define bitscan_loop(B) for(; B; B = _blsr_u64(B))
 
-struct PextEntry {
+struct SliderEntry {
     Bitboard  mask;
-    Bitboard *data;
+    const Bitboard *data;
+#ifdef USE_PEXT
+    constexpr unsigned index(Bitboard occupied) const {
+        return unsigned(pext(occupied, mask));
+    }
+#else
+    Bitboard magic;
+    unsigned shift;
+
+    inline unsigned index(Bitboard occupied) const {
+        return unsigned(((occupied & mask) * magic) >> shift);
+    }
+#endif
 
     inline Bitboard attacks(Bitboard occupied) const {
-        return data[pext(occupied, mask)];
+        return data[index(occupied)];
     }
 };
 
-extern Bitboard PAWN_ATTACK[NB_SIDE][NB_SQUARE];
-extern Bitboard KNIGHT_MOVE[NB_SQUARE];
-extern Bitboard KING_MOVE[NB_SQUARE];
-extern PextEntry BISHOP_MOVE[NB_SQUARE];
-extern PextEntry ROOK_MOVE[NB_SQUARE];
-
-extern Bitboard BETWEEN_BB[NB_SQUARE][NB_SQUARE];
+// Attack tables are generated at compile time, except magics which are searched at startup by BB::init()
+extern const std::array<std::array<Bitboard, NB_SQUARE>, NB_SIDE> PAWN_ATTACK;
+extern const std::array<Bitboard, NB_SQUARE> KNIGHT_MOVE;
+extern const std::array<Bitboard, NB_SQUARE> KING_MOVE;
+#ifdef USE_PEXT
+extern const std::array<SliderEntry, NB_SQUARE> BISHOP_MOVE;
+extern const std::array<SliderEntry, NB_SQUARE> ROOK_MOVE;
+#else
+extern std::array<SliderEntry, NB_SQUARE> BISHOP_MOVE;
+extern std::array<SliderEntry, NB_SQUARE> ROOK_MOVE;
+#endif
+
+extern const std::array<std::array<Bitboard, NB_SQUARE>, NB_SQUARE> BETWEEN_BB;
 
 template<Direction D>
 constexpr Bitboard shift(Bitboard b)
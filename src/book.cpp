@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <fstream>
+#include "book.h"
+#include "movegen.h"
+#include "utils.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BOOK_MMAP
+#endif
+
+namespace Belette {
+
+static inline uint64_t fromBigEndian(uint64_t x) { return __builtin_bswap64(x); }
+static inline uint16_t fromBigEndian(uint16_t x) { return __builtin_bswap16(x); }
+
+// Polyglot move: to square in bits 0-5, from square in bits 6-11, promotion piece in bits 12-14 (1 = knight ... 4 = queen)
+// Castling moves are encoded as king takes own rook
+static uint16_t polyglotMove(Move m) {
+    Square from = moveFrom(m), to = moveTo(m);
+    int promotion = 0;
+
+    if (moveType(m) == CASTLING)
+        to = square(to > from ? FILE_H : FILE_A, rankOf(from));
+    else if (moveType(m) == PROMOTION)
+        promotion = movePromotionType(m) - KNIGHT + 1;
+
+    return uint16_t(int(to) | (int(from) << 6) | (promotion << 12));
+}
+
+Book::Book(): rng(uint64_t(now())) { }
+
+bool Book::open(const std::string &filename) {
+    close();
+
+#ifdef BOOK_MMAP
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < off_t(sizeof(PolyglotEntry))) {
+        ::close(fd);
+        return false;
+    }
+
+    mappingSize = size_t(st.st_size);
+    mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        return false;
+    }
+
+    entries = static_cast<const PolyglotEntry *>(mapping);
+#else
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return false;
+
+    size_t size = size_t(file.tellg());
+    buffer.resize(size / sizeof(PolyglotEntry));
+    file.seekg(0);
+    if (buffer.empty() || !file.read(reinterpret_cast<char *>(buffer.data()), buffer.size() * sizeof(PolyglotEntry))) {
+        buffer.clear();
+        return false;
+    }
+
+    entries = buffer.data();
+#endif
+
+    nbEntries = (mapping ? mappingSize : buffer.size() * sizeof(PolyglotEntry)) / sizeof(PolyglotEntry);
+
+    return true;
+}
+
+void Book::close() {
+#ifdef BOOK_MMAP
+    if (mapping) munmap(mapping, mappingSize);
+#endif
+    mapping = nullptr;
+    mappingSize = 0;
+    buffer.clear();
+    entries = nullptr;
+    nbEntries = 0;
+}
+
+Move Book::toMove(const Position &pos, uint16_t bookMove) const {
+    Move move = MOVE_NONE;
+
+    enumerateLegalMoves(pos, [&](Move m) {
+        if (polyglotMove(m) != (bookMove & 0x7FFF)) return true;
+
+        move = m;
+        return false;
+    });
+
+    return move;
+}
+
+std::vector<BookMove> Book::moves(const Position &pos) const {
+    std::vector<BookMove> result;
+    if (!isOpen()) return result;
+
+    // Entries are sorted by key: binary search the first one of the position
+    uint64_t key = pos.polyglotHash();
+    const PolyglotEntry *it = std::partition_point(entries, entries + nbEntries, [key](const PolyglotEntry &e) {
+        return fromBigEndian(e.key) < key;
+    });
+
+    for (; it != entries + nbEntries && fromBigEndian(it->key) == key; ++it) {
+        Move move = toMove(pos, fromBigEndian(it->move));
+        if (move != MOVE_NONE) result.push_back({move, fromBigEndian(it->weight)});
+    }
+
+    return result;
+}
+
+Move Book::probe(const Position &pos) {
+    std::vector<BookMove> bookMoves = moves(pos);
+
+    int total = 0;
+    for (auto &bm : bookMoves) total += bm.weight;
+
+    // Moves with a null weight are never played
+    if (total == 0) return MOVE_NONE;
+
+    int pick = int(rng() % uint64_t(total));
+    for (auto &bm : bookMoves) {
+        if (pick < bm.weight) return bm.move;
+        pick -= bm.weight;
+    }
+
+    return MOVE_NONE;
+}
+
+} /* namespace Belette */
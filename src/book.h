@@ -0,0 +1,62 @@
+#ifndef BOOK_H_INCLUDED
+#define BOOK_H_INCLUDED
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "chess.h"
+#include "position.h"
+
+namespace Belette {
+
+// Polyglot book entry, stored big endian and sorted by key in the file
+struct PolyglotEntry {
+    uint64_t key;
+    uint16_t move;
+    uint16_t weight;
+    uint32_t learn;
+};
+
+static_assert(sizeof(PolyglotEntry) == 16);
+
+struct BookMove {
+    Move move;
+    int weight;
+};
+
+// Polyglot opening book, the file is memory mapped (read in memory on non POSIX systems)
+class Book {
+public:
+    Book();
+    ~Book() { close(); }
+    Book(const Book&) = delete;
+    Book& operator=(const Book&) = delete;
+
+    bool open(const std::string &filename);
+    void close();
+    inline bool isOpen() const { return entries != nullptr; }
+    inline size_t size() const { return nbEntries; }
+
+    // Legal book moves of the position with their weights
+    std::vector<BookMove> moves(const Position &pos) const;
+
+    // Random book move chosen according to the weights, MOVE_NONE if the position is not in the book
+    Move probe(const Position &pos);
+
+private:
+    const PolyglotEntry *entries = nullptr;
+    size_t nbEntries = 0;
+
+    void *mapping = nullptr;
+    size_t mappingSize = 0;
+    std::vector<PolyglotEntry> buffer;
+
+    std::mt19937_64 rng;
+
+    Move toMove(const Position &pos, uint16_t bookMove) const;
+};
+
+} /* namespace Belette */
+
+#endif /* BOOK_H_INCLUDED */
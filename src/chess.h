@@ -164,7 +164,7 @@ constexpr Bitboard Rank8BB = Rank1BB << (8 * 7);
 constexpr Bitboard bb(Square s) { return (1ULL << s); }
 //constexpr Bitboard bb(Square s) { return SQUARE_BB[s]; }
 
-inline Square& operator++(Square& sq) { return sq = Square(int(sq) + 1); }
+constexpr Square& operator++(Square& sq) { return sq = Square(int(sq) + 1); }
 inline Square& operator--(Square& sq) { return sq = Square(int(sq) - 1); }
 
 constexpr Square operator+(Square sq, Direction dir) { return Square(int(sq) + int(dir)); }
@@ -339,16 +339,16 @@ constexpr Direction pawnDirection(Side s) {
     return s == WHITE ? UP : DOWN;
 }
 
-inline Bitboard operator&(Bitboard b, Square s) { return b & bb(s); }
-inline Bitboard operator|(Bitboard b, Square s) { return b | bb(s); }
-inline Bitboard operator^(Bitboard b, Square s) { return b ^ bb(s); }
-inline Bitboard operator&(Square s, Bitboard b) { return b & s; }
-inline Bitboard operator|(Square s, Bitboard b) { return b | s; }
-inline Bitboard operator^(Square s, Bitboard b) { return b ^ s; }
+constexpr Bitboard operator&(Bitboard b, Square s) { return b & bb(s); }
+constexpr Bitboard operator|(Bitboard b, Square s) { return b | bb(s); }
+constexpr Bitboard operator^(Bitboard b, Square s) { return b ^ bb(s); }
+constexpr Bitboard operator&(Square s, Bitboard b) { return b & s; }
+constexpr Bitboard operator|(Square s, Bitboard b) { return b | s; }
+constexpr Bitboard operator^(Square s, Bitboard b) { return b ^ s; }
 
-inline Bitboard& operator|=(Bitboard& b, Square s) { return b |= bb(s); }
-inline Bitboard& operator^=(Bitboard& b, Square s) { return b ^= bb(s); }
-inline Bitboard  operator|(Square s1, Square s2) { return bb(s1) | bb(s2); }
+constexpr Bitboard& operator|=(Bitboard& b, Square s) { return b |= bb(s); }
+constexpr Bitboard& operator^=(Bitboard& b, Square s) { return b ^= bb(s); }
+constexpr Bitboard  operator|(Square s1, Square s2) { return bb(s1) | bb(s2); }
 
 } /* namespace Belette */
 
@@ -0,0 +1,99 @@
+#include <climits>
+#include "cpu.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace Belette {
+
+namespace CPU {
+
+struct ArchLevel {
+    const char* name;
+    bool (*supported)();
+};
+
+// From the best to the most generic
+static const ArchLevel ARCH_LEVELS[] = {
+    { "avx512", [] { return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("avx2"); } },
+    { "bmi2",   [] { return __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"); } },
+    { "popcnt", [] { return __builtin_cpu_supports("popcnt") && __builtin_cpu_supports("sse4.1"); } },
+    { "generic", [] { return true; } },
+};
+
+const char* buildArch() {
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+    return "avx512";
+#elif defined(__BMI2__) && defined(__AVX2__)
+    return "bmi2";
+#elif defined(__POPCNT__)
+    return "popcnt";
+#else
+    return "generic";
+#endif
+}
+
+const char* bestArch() {
+    __builtin_cpu_init();
+
+    for (auto &level : ARCH_LEVELS) {
+        if (level.supported()) return level.name;
+    }
+
+    return "generic";
+}
+
+bool isSupported(std::string &missing) {
+    __builtin_cpu_init();
+    missing.clear();
+
+    auto check = [&](bool supported, const char* name) {
+        if (!supported) missing += (missing.empty() ? "" : " ") + std::string(name);
+    };
+
+#ifdef __POPCNT__
+    check(__builtin_cpu_supports("popcnt"), "popcnt");
+#endif
+#ifdef __SSE4_1__
+    check(__builtin_cpu_supports("sse4.1"), "sse4.1");
+#endif
+#ifdef __AVX2__
+    check(__builtin_cpu_supports("avx2"), "avx2");
+#endif
+#ifdef __BMI2__
+    check(__builtin_cpu_supports("bmi2"), "bmi2");
+#endif
+#ifdef __AVX512F__
+    check(__builtin_cpu_supports("avx512f"), "avx512f");
+#endif
+#ifdef __AVX512BW__
+    check(__builtin_cpu_supports("avx512bw"), "avx512bw");
+#endif
+
+    return missing.empty();
+}
+
+void launchBest(char* argv[]) {
+#ifdef __linux__
+    char exe[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (len <= 0) return;
+    exe[len] = '\0';
+
+    __builtin_cpu_init();
+
+    for (auto &level : ARCH_LEVELS) {
+        if (!level.supported()) continue;
+
+        std::string candidate = std::string(exe) + "-" + level.name;
+        if (access(candidate.c_str(), X_OK) == 0) {
+            execv(candidate.c_str(), argv); // Only returns on failure, try the next level
+        }
+    }
+#endif
+}
+
+} // namespace CPU
+
+} /* namespace Belette */
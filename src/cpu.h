@@ -0,0 +1,26 @@
+#ifndef CPU_H_INCLUDED
+#define CPU_H_INCLUDED
+
+#include <string>
+
+namespace Belette {
+
+namespace CPU {
+
+// Instruction set level this binary was compiled for (see ARCH in the Makefile)
+const char* buildArch();
+
+// Best instruction set level supported by the running cpu
+const char* bestArch();
+
+// Check that the running cpu supports every instruction set extension used by this binary, missing ones are listed in "missing"
+bool isSupported(std::string &missing);
+
+// Launcher build only: replace the process with the sibling binary (<exe>-<arch>) of the best supported level, returns if there is none
+void launchBest(char* argv[]);
+
+} // namespace CPU
+
+} /* namespace Belette */
+
+#endif /* CPU_H_INCLUDED */
@@ -0,0 +1,147 @@
+#include <atomic>
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <iomanip>
+#include "datagen.h"
+#include "packedpos.h"
+#include "engine.h"
+#include "game.h"
+#include "uci.h"
+
+namespace Belette {
+
+class DataGenEngine : public Engine {
+public:
+    DataGenEngine(size_t hashSize): Engine(table), table(hashSize * 1024 * 1024) { }
+
+    Move bestMove = MOVE_NONE;
+    Score score = SCORE_NONE;
+
+private:
+    TranspositionTable table;
+
+    virtual void onSearchProgress(const SearchEvent &event) { }
+    virtual void onSearchFinish(const SearchEvent &event) {
+        bestMove = event.pv.empty() ? MOVE_NONE : event.pv.front();
+        score = event.bestScore;
+    }
+};
+
+// Play a single game and collect its quiet positions, returns RESULT_NONE if the opening was rejected
+GameResult playGame(DataGenEngine &engine, const Position &opening, const DataGenParams &params, std::vector<PackedPosition> &positions) {
+    Position pos = opening;
+    int winCount[NB_SIDE] = {0};
+
+    SearchLimits limits;
+    limits.maxNodes = params.nodes;
+
+    positions.clear();
+
+    for (int ply = 0; ply < params.maxPlies; ply++) {
+        GameResult result = getGameResult(pos);
+        if (result != RESULT_NONE) return result;
+
+        engine.position() = pos;
+        engine.searchSync(limits);
+
+        if (engine.bestMove == MOVE_NONE || engine.score == SCORE_NONE) return RESULT_NONE;
+
+        // Score from white point of view
+        Score score = pos.getSideToMove() == WHITE ? engine.score : -engine.score;
+
+        if (ply == 0 && std::abs(score) > params.maxOpeningScore) return RESULT_NONE;
+
+        winCount[WHITE] = score >= params.winScore ? winCount[WHITE] + 1 : 0;
+        winCount[BLACK] = score <= -params.winScore ? winCount[BLACK] + 1 : 0;
+        if (winCount[WHITE] >= 2 * params.winMoves) return RESULT_WHITE_WIN;
+        if (winCount[BLACK] >= 2 * params.winMoves) return RESULT_BLACK_WIN;
+
+        // Only quiet positions are kept, the static evaluation cannot be trained on tactics
+        if (!pos.inCheck() && !pos.isTactical(engine.bestMove) && std::abs(score) < SCORE_MATE_MAX_PLY)
+            positions.push_back(packPosition(pos, score));
+
+        pos.doMove(engine.bestMove);
+    }
+
+    return RESULT_DRAW;
+}
+
+void datagen(const DataGenParams &params) {
+    std::ofstream file(params.filename, std::ios::binary | std::ios::app);
+
+    if (!file.is_open()) {
+        console << "Unable to open '" << params.filename << "'" << std::endl;
+        return;
+    }
+
+    std::mutex fileMutex;
+    std::atomic<uint64_t> nextGame = 0;
+    std::atomic<bool> finished = false;
+    size_t nbPositions = 0, nbGames = 0;
+    TimeMs start = now(), lastReport = start;
+
+    auto report = [&]() {
+        TimeMs elapsed = std::max<TimeMs>(1, now() - start);
+
+        console << "Positions: " << nbPositions << " Games: " << nbGames
+                << " Positions/s: " << nbPositions * 1000 / elapsed
+                << " Time: " << elapsed / 1000 << "s" << std::endl;
+    };
+
+    auto worker = [&]() {
+        DataGenEngine engine(params.hashSize);
+        std::vector<PackedPosition> positions;
+        Position opening;
+
+        while (!finished) {
+            uint64_t gameSeed = params.seed ^ (nextGame++ * 0x9E3779B97F4A7C15ull);
+
+            // Alternate the side to move after the opening
+            if (!randomOpening(opening, params.randomPlies + int(gameSeed & 1), gameSeed)) continue;
+
+            engine.newGame();
+
+            GameResult result = playGame(engine, opening, params, positions);
+            if (result == RESULT_NONE) continue;
+
+            for (auto &packed : positions) {
+                setPackedResult(packed, result);
+            }
+
+            std::lock_guard<std::mutex> lock(fileMutex);
+            if (finished) break;
+
+            size_t count = std::min(positions.size(), params.nbPositions - nbPositions);
+            file.write(reinterpret_cast<const char *>(positions.data()), count * sizeof(PackedPosition));
+
+            nbPositions += count;
+            nbGames++;
+
+            if (nbPositions >= params.nbPositions) finished = true;
+
+            if (now() - lastReport >= 5000) {
+                lastReport = now();
+                report();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i=0; i<std::max(1, params.nbThreads); i++) {
+        threads.emplace_back(worker);
+    }
+
+    for (auto &th : threads) {
+        th.join();
+    }
+
+    file.flush();
+
+    console << std::endl << "-----------------------------" << std::endl;
+    report();
+}
+
+} /* namespace Belette */
@@ -0,0 +1,31 @@
+#ifndef DATAGEN_H_INCLUDED
+#define DATAGEN_H_INCLUDED
+
+#include <string>
+#include "chess.h"
+
+namespace Belette {
+
+constexpr size_t DEFAULT_DATAGEN_NODES = 5000;
+
+struct DataGenParams {
+    std::string filename = "data.bin";
+    size_t nbPositions = 1000000; // Stop once this many positions have been written
+    int nbThreads = 1;
+    size_t nodes = DEFAULT_DATAGEN_NODES;
+    size_t hashSize = 16; // In megabytes, per thread
+    int randomPlies = 8;
+    uint64_t seed = 0;
+
+    Score maxOpeningScore = 400; // Unbalanced random openings are discarded
+    Score winScore = 2000; // Adjudicate a win once both sides agree for winMoves moves
+    int winMoves = 4;
+    int maxPlies = 400; // Adjudicate a draw after this many plies
+};
+
+// Play fixed nodes self-play games from random openings and append quiet positions to a packed binary file
+void datagen(const DataGenParams &params);
+
+} /* namespace Belette */
+
+#endif /* DATAGEN_H_INCLUDED */
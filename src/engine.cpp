@@ -1,22 +1,43 @@
 #include <iostream>
 #include <thread>
 #include <cmath>
+#include <array>
 #include "engine.h"
 #include "movegen.h"
 #include "evaluate.h"
 #include "movepicker.h"
+#include "stats.h"
+#include "book.h"
 
 namespace Belette {
 
-int Engine::LMRTable[MAX_PLY][MAX_MOVE];
+// Natural logarithm usable at compile time: reduce to [1,2) then 2*atanh((x-1)/(x+1)) series
+constexpr double constLog(double x) {
+    constexpr double LN2 = 0.693147180559945309417;
+    int k = 0;
+    while (x >= 2.0) { x /= 2.0; k++; }
+
+    double y = (x - 1) / (x + 1), y2 = y * y;
+    double term = y, sum = 0;
+    for (int i = 1; i < 64; i += 2) {
+        sum += term / i;
+        term *= y2;
+    }
+
+    return k * LN2 + 2 * sum;
+}
+
+constexpr auto LMRTable = [] {
+    std::array<std::array<int, MAX_MOVE>, MAX_PLY> table{};
 
-void Engine::init() {
     for (int d=1; d<MAX_PLY; d++) {
         for (int m=1; m<MAX_PLY; m++) {
-            LMRTable[d][m] = int(0.25 + 0.46 * std::log(d) * std::log(m));
+            table[d][m] = int(0.25 + 0.46 * constLog(d) * constLog(m));
         }
     }
-}
+
+    return table;
+}();
 
 void updatePv(MoveList &pv, Move move, const MoveList &childPv) {
     pv.clear();
@@ -39,15 +60,32 @@ void Engine::waitForSearchFinish() {
     }
 }
 
+void Engine::initSearch(const SearchLimits &limits) {
+    moveHistory.newSearch(historyDecay);
+    sd = std::make_unique<SearchData>(position(), limits, moveHistory);
+    aborted = false;
+    searching = true;
+    
+    if (hashAging) tt.newSearch();
+}
+
 // Search entry point
 void Engine::search(const SearchLimits &limits) {
     if (searching) return;
 
-    sd = std::make_unique<SearchData>(position(), limits);
-    aborted = false;
-    searching = true;
-    
-    tt.newSearch();
+    // Book moves are played instantly, without starting a search thread
+    if (book && !limits.infinite && !limits.ponder && limits.searchMoves.empty()) {
+        Move bookMove = book->probe(rootPosition);
+
+        if (bookMove != MOVE_NONE) {
+            MoveList pv;
+            pv.push_back(bookMove);
+            onSearchFinish(SearchEvent(0, 0, pv, 0, 0, 0, 0));
+            return;
+        }
+    }
+
+    initSearch(limits);
 
     std::thread th([&] { 
         this->idSearch();
@@ -55,10 +93,23 @@ void Engine::search(const SearchLimits &limits) {
     th.detach();
 }
 
+// Run the search in the calling thread, used when the caller manages its own threads
+void Engine::searchSync(const SearchLimits &limits) {
+    if (searching) return;
+
+    initSearch(limits);
+    idSearch();
+}
+
 void Engine::stop() {
     aborted = true;
 }
 
+// Can be called from any thread, even before the ponder search has started
+void Engine::ponderhit() {
+    ponderhitPending = true;
+}
+
 // Iterative deepening loop
 template<Side Me>
 void Engine::idSearch() {
@@ -117,6 +168,8 @@ void Engine::idSearch() {
 
         if (sd->limits.maxDepth > 0 && depth >= sd->limits.maxDepth) break;
 
+        if (sd->mateFound(bestScore) || sd->mateDepthReached(depth)) break;
+
         if (sd->shouldStopSoft()) break;
     }
 
@@ -127,11 +180,36 @@ void Engine::idSearch() {
         onSearchProgress(event);
     }
 
+    // In ponder or infinite mode bestmove must not be sent before the gui tells us to
+    while ((sd->pondering || sd->limits.infinite) && !searchAborted()) {
+        if (sd->pondering && ponderhitPending) sd->ponderhit();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // If the pv is too short try to find a move to ponder on in the TT
+    if (bestPv.size() == 1) {
+        Move ponderMove = getPonderMove<Me>(bestPv.front());
+        if (ponderMove != MOVE_NONE) bestPv.push_back(ponderMove);
+    }
+
     onSearchFinish(event);
 
+    ponderhitPending = false;
     searching = false;
 }
 
+template<Side Me>
+Move Engine::getPonderMove(Move bestMove) {
+    Position &pos = sd->position;
+    
+    pos.doMove<Me>(bestMove);
+    auto&&[ttHit, tte] = tt.get(pos.hash());
+    Move ponderMove = ttHit && pos.isLegal<~Me>(tte->move()) ? tte->move() : MOVE_NONE;
+    pos.undoMove<Me>(bestMove);
+
+    return ponderMove;
+}
+
 // Negamax search
 template<Side Me, NodeType NT>
 Score Engine::pvSearch(Score alpha, Score beta, int depth, int ply, bool cutNode) {
@@ -139,9 +217,9 @@ Score Engine::pvSearch(Score alpha, Score beta, int depth, int ply, bool cutNode
     constexpr bool RootNode = (NT == NodeType::Root);
     constexpr NodeType QNodeType = PvNode ? NodeType::PV : NodeType::NonPV;
 
-    // Quiescence
+    // Quiescence, always entered at depth 0 which is the ply where quiet checks are tried
     if (depth <= 0) {
-        return qSearch<Me, QNodeType>(alpha, beta, depth, ply);
+        return qSearch<Me, QNodeType>(alpha, beta, 0, ply);
     }
 
     // Update selDepth
@@ -149,6 +227,10 @@ Score Engine::pvSearch(Score alpha, Score beta, int depth, int ply, bool cutNode
         sd->selDepth = ply + 1;
     }
 
+    if (sd->pondering && ponderhitPending.load(std::memory_order_relaxed)) [[unlikely]] {
+        sd->ponderhit();
+    }
+
     // Check if we should stop according to limits
     if (!RootNode && sd->shouldStop()) [[unlikely]] {
         stop();
@@ -167,6 +249,8 @@ Score Engine::pvSearch(Score alpha, Score beta, int depth, int ply, bool cutNode
         if (alpha >= beta) return alpha;
     }
 
+    STATS_NODE(STAT_NODES, NT, ply);
+
     Node& node = sd->node(ply);
     Score alphaOrig = alpha;
     Score bestScore = -SCORE_INFINITE;
@@ -175,6 +259,7 @@ Score Engine::pvSearch(Score alpha, Score beta, int depth, int ply, bool cutNode
     bool inCheck = pos.inCheck();
     Score eval;
     bool improving = false;
+    bool mateSearch = sd->useMateLimit(); // Disable pruning that can hide mates (zugzwang, quiet mating moves)
 
     if (RootNode) {
         node.pv.clear();
@@ -190,6 +275,11 @@ Score Engine::pvSearch(Score alpha, Score beta, int depth, int ply, bool cutNode
         return evaluate<Me>(pos); // TODO: verify if we are in check ?
     }
 
+    // In mate search there is no need to look further than the requested mate length
+    if (sd->pastMateLimit(ply)) {
+        return SCORE_DRAW;
+    }
+
     // Query Transposition Table
     auto&&[ttHit, tte] = tt.get(pos.hash());
     Score ttScore = tte->score(ply);
@@ -197,8 +287,12 @@ Score Engine::pvSearch(Score alpha, Score beta, int depth, int ply, bool cutNode
     Move ttMove = ttHit ? tte->move() : MOVE_NONE;
     bool ttTactical = ttHit ? pos.isTactical(ttMove) : false;
 
+    STATS_NODE(STAT_TT_PROBES, NT, ply);
+    if (ttHit) STATS_NODE(STAT_TT_HITS, NT, ply);
+
     // Transposition Table cutoff
     if (!PvNode && ttHit && tte->depth() >= depth && tte->canCutoff(ttScore, beta)) {
+        STATS_NODE(STAT_TT_CUTOFFS, NT, ply);
         return ttScore;
     }
 
@@ -226,30 +320,35 @@ Score Engine::pvSearch(Score alpha, Score beta, int depth, int ply, bool cutNode
     }
 
     // Internal Iterative Reduction (IIR)
-    if (depth >= 4 && ttMove == MOVE_NONE) {
+    if (depth >= 4 && ttMove == MOVE_NONE && !mateSearch) {
         depth--;
     }
 
     // Reverse futility pruning (RFP)
-    if (!PvNode && !inCheck && depth <= 8
+    if (!PvNode && !inCheck && !mateSearch && depth <= 8
         && eval - ((improving ? 60 : 120) * depth) >= beta)
     {
+        STATS_NODE(STAT_RFP_PRUNES, NT, ply);
         return eval;
     }
 
     // Razoring
-    if (!PvNode && !inCheck && depth <= 2
+    if (!PvNode && !inCheck && !mateSearch && depth <= 2
         && eval + (400 * depth) <= alpha)
     {
-        Score score = qSearch<Me, QNodeType>(alpha, beta, depth, ply);
-        if (score <= alpha)
+        STATS_NODE(STAT_RAZORING_TRIES, NT, ply);
+        Score score = qSearch<Me, QNodeType>(alpha, beta, 0, ply);
+        if (score <= alpha) {
+            STATS_NODE(STAT_RAZORING_PRUNES, NT, ply);
             return score;
+        }
     }
 
     // Null move pruning (NMP)
-    if (!PvNode && !inCheck
+    if (!PvNode && !inCheck && !mateSearch
         && pos.previousMove() != MOVE_NULL && pos.hasNonPawnMateriel<Me>() && eval >= beta)
     {
+        STATS_NODE(STAT_NMP_TRIES, NT, ply);
         tt.prefetch(pos.getHashAfterNullMove());
         int R = 4 + depth / 4;
 
@@ -258,6 +357,7 @@ Score Engine::pvSearch(Score alpha, Score beta, int depth, int ply, bool cutNode
         pos.undoNullMove<Me>();
 
         if (score >= beta) {
+            STATS_NODE(STAT_NMP_PRUNES, NT, ply);
             // TODO: verification search ?
             return score >= SCORE_MATE_MAX_PLY ? beta : score;
         }
@@ -271,7 +371,7 @@ Score Engine::pvSearch(Score alpha, Score beta, int depth, int ply, bool cutNode
     sd->moveHistory.clearKillers(ply+1);
 
     int nbMoves = 0;
-    MovePicker mp(pos, ttMove, &sd->moveHistory, ply);
+    MovePicker mp(pos, sd->moveArena, ttMove, &sd->moveHistory, ply, tt);
     //MovePicker *mp = new (&node.mp) MovePicker(pos, ttMove, &sd->moveHistory, ply);
     PartialMoveList quietMoves;
     
@@ -283,14 +383,16 @@ Score Engine::pvSearch(Score alpha, Score beta, int depth, int ply, bool cutNode
         nbMoves++;
 
         bool moveIsTactical = pos.isTactical(move);
+        bool givesCheck = pos.givesCheck<Me>(move);
 
         // Late move pruning
-        if (!RootNode && bestScore > -SCORE_MATE_MAX_PLY) {
+        if (!RootNode && !mateSearch && bestScore > -SCORE_MATE_MAX_PLY) {
             // Move count pruning
             skipQuiets = (nbMoves >= 3 + depth*depth/(improving ? 1 : 2));
 
-            // SEE Pruning
-            if (depth <= 8 && !pos.see(move, moveIsTactical ? -100*depth : -60*depth)) {
+            // SEE Pruning, checks get the tactical margin
+            if (depth <= 8 && !mp.see(move, (moveIsTactical || givesCheck) ? -100*depth : -60*depth)) {
+                STATS_NODE(STAT_SEE_PRUNES, NT, ply);
                 return true; // continue;
             }
         }
@@ -305,12 +407,12 @@ Score Engine::pvSearch(Score alpha, Score beta, int depth, int ply, bool cutNode
 
         Score score;
 
-        // Late move reduction (LMR)
-        if (depth >= 2 && nbMoves > 1) {
+        // Late move reduction (LMR), not in mate search which stops at the nominal depth
+        if (depth >= 2 && nbMoves > 1 && !mateSearch) {
             int R = LMRTable[depth][nbMoves];
 
             R -= PvNode;
-            R -= pos.inCheck();
+            R -= givesCheck;
             R += !ttPv;
             R += ttTactical;
             R += 2*cutNode;
@@ -320,9 +422,11 @@ Score Engine::pvSearch(Score alpha, Score beta, int depth, int ply, bool cutNode
             R = std::min(depth - 1, std::max(1, R));
 
             // Reduced depth, Zero window
+            STATS_NODE(STAT_LMR_SEARCHES, NT, ply);
             score = -pvSearch<~Me, NodeType::NonPV>(-alpha-1, -alpha, depth-R, ply+1, true);
 
             if (score > alpha && R != 1) {
+                STATS_NODE(STAT_LMR_RESEARCHES, NT, ply);
                 // Full depth, Zero window
                 score = -pvSearch<~Me, NodeType::NonPV>(-alpha-1, -alpha, depth-1, ply+1, !cutNode);
             }
@@ -352,6 +456,9 @@ Score Engine::pvSearch(Score alpha, Score beta, int depth, int ply, bool cutNode
                     updatePv(node.pv, move, sd->node(ply+1).pv);
 
                 if (alpha >= beta) {
+                    STATS_NODE(STAT_BETA_CUTOFFS, NT, ply);
+                    if (nbMoves == 1) STATS_NODE(STAT_FIRST_MOVE_CUTOFFS, NT, ply);
+
                     sd->moveHistory.update<Me>(pos, bestMove, ply, depth, quietMoves);
                     return false; // break
                 }
@@ -371,9 +478,11 @@ Score Engine::pvSearch(Score alpha, Score beta, int depth, int ply, bool cutNode
     }
 
     // Update Transposition Table
+    // Mate search scores depend on the ply of the mate limit, only the move is kept for the ordering
     Bound ttBound =         bestScore >= beta         ? BOUND_LOWER : 
                     !PvNode || bestScore <= alphaOrig ? BOUND_UPPER : BOUND_EXACT;
-    tt.set(tte, pos.hash(), depth, ply, ttBound, bestMove, SCORE_NONE, bestScore, ttPv);
+    if (mateSearch) tt.set(tte, pos.hash(), 0, ply, BOUND_NONE, bestMove, SCORE_NONE, SCORE_NONE, ttPv);
+    else tt.set(tte, pos.hash(), depth, ply, ttBound, bestMove, SCORE_NONE, bestScore, ttPv);
 
     return bestScore;
 }
@@ -409,6 +518,13 @@ Score Engine::qSearch(Score alpha, Score beta, int depth, int ply) {
         return evaluate<Me>(pos); // TODO: check if we are in check ?
     }
 
+    if (sd->pastMateLimit(ply)) {
+        return SCORE_DRAW;
+    }
+
+    STATS_NODE(STAT_QNODES, NT, ply);
+    STATS_QSEARCH_DEPTH(-depth);
+
     bool inCheck = pos.inCheck();
     Score eval = SCORE_NONE;
 
@@ -418,8 +534,12 @@ Score Engine::qSearch(Score alpha, Score beta, int depth, int ply) {
     int ttDepth = inCheck ? 1 : 0; // If we are in check use depth=1 because when we are in check we go through all moves
     Score ttScore = tte->score(ply);
 
+    STATS_NODE(STAT_QTT_PROBES, NT, ply);
+    if (ttHit) STATS_NODE(STAT_QTT_HITS, NT, ply);
+
     // Transposition Table cutoff
     if (!PvNode && ttHit && tte->depth() >= ttDepth && tte->canCutoff(ttScore, beta)) {
+        STATS_NODE(STAT_QTT_CUTOFFS, NT, ply);
         return ttScore;
     }
 
@@ -438,6 +558,7 @@ Score Engine::qSearch(Score alpha, Score beta, int depth, int ply) {
         }
 
         if (eval >= beta) {
+            STATS_NODE(STAT_QSTANDPAT_CUTOFFS, NT, ply);
             return eval;
         }
 
@@ -450,12 +571,18 @@ Score Engine::qSearch(Score alpha, Score beta, int depth, int ply) {
     Move ttMove = tte->move();
     // If ttMove is quiet we don't want to use it past a certain depth to allow qSearch to stabilize
     bool useTTMove = ttHit && isValidMove(ttMove) && (depth >= -7 || pos.inCheck() || pos.isTactical(ttMove));
-    MovePicker mp(pos, useTTMove ? ttMove : MOVE_NONE);
+    MovePicker mp(pos, sd->moveArena, useTTMove ? ttMove : MOVE_NONE, tt);
     //MovePicker *mp = new (&node.mp) MovePicker(pos, useTTMove ? ttMove : MOVE_NONE);
 
-    mp.enumerate<QUIESCENCE, Me>([&](Move move, /*unused*/bool& skipQuiets) -> bool {
+    // Pruning every evasion would return a mate score that mate search trusts
+    bool seePruning = !(inCheck && sd->useMateLimit());
+
+    auto searchMove = [&](Move move, /*unused*/bool& skipQuiets) -> bool {
         // SEE Pruning
-        if (!pos.see(move, 0)) return true; // continue;
+        if (seePruning && !mp.see(move, 0)) {
+            STATS_NODE(STAT_QSEE_PRUNES, NT, ply);
+            return true; // continue;
+        }
         
         sd->nbNodes++;
 
@@ -479,11 +606,18 @@ Score Engine::qSearch(Score alpha, Score beta, int depth, int ply) {
         }
 
         return true;
-    }); if (searchAborted()) return bestScore;
+    };
+
+    // Quiet checks are only tried at the first qSearch ply
+    if (depth == 0) mp.enumerate<QUIESCENCE_CHECKS, Me>(searchMove);
+    else mp.enumerate<QUIESCENCE, Me>(searchMove);
+
+    if (searchAborted()) return bestScore;
 
     // Update Transposition Table
     Bound ttBound = bestScore >= beta ? BOUND_LOWER : BOUND_UPPER;
-    tt.set(tte, pos.hash(), ttDepth, ply, ttBound, bestMove, eval, bestScore, ttPv);
+    if (sd->useMateLimit()) tt.set(tte, pos.hash(), 0, ply, BOUND_NONE, bestMove, eval, SCORE_NONE, ttPv);
+    else tt.set(tte, pos.hash(), ttDepth, ply, ttBound, bestMove, eval, bestScore, ttPv);
 
     return bestScore;
 }
@@ -1,6 +1,7 @@
 #ifndef ENGINE_H_INCLUDED
 #define ENGINE_H_INCLUDED
 
+#include <atomic>
 #include <memory>
 #include "chess.h"
 #include "position.h"
@@ -13,6 +14,8 @@
 
 namespace Belette {
 
+class Book;
+
 struct SearchLimits {
     TimeMs timeLeft[NB_SIDE] = {0};
     TimeMs increment[NB_SIDE] = {0};
@@ -20,6 +23,9 @@ struct SearchLimits {
     int maxDepth = 0;
     size_t maxNodes = 0;
     TimeMs maxTime = 0;
+    int mate = 0;
+    bool infinite = false;
+    bool ponder = false;
     MoveList searchMoves;
 };
 
@@ -30,29 +36,46 @@ struct Node {
 };
 
 struct SearchData {
-    SearchData(const Position& pos_, const SearchLimits& limits_)
-    : position(pos_), limits(limits_), nbNodes(0) {
+    SearchData(const Position& pos_, const SearchLimits& limits_, MoveHistory &moveHistory_)
+    : position(pos_), limits(limits_), nbNodes(0), pondering(limits_.ponder), moveHistory(moveHistory_) {
         start();
     }
 
     void initAllocatedTime();
 
     inline TimeMs getElapsed() { return now() - startTime; }
+    // Time spent on our own clock, time spent pondering is not counted
+    inline TimeMs getClockElapsed() { return now() - clockStart; }
     inline void start() {
-        startTime = now();
+        startTime = clockStart = now();
         initAllocatedTime();
     }
+
+    // The opponent played the expected move: the ponder search becomes a normal search
+    inline void ponderhit() {
+        clockStart = now();
+        pondering = false;
+    }
     
     inline bool useTournamentTime() { return !!(limits.timeLeft[WHITE] | limits.timeLeft[WHITE]); }
     inline bool useFixedTime() { return limits.maxTime > 0; }
     inline bool useTimeLimit() { return useTournamentTime() || useTimeLimit(); }
     inline bool useNodeCountLimit() { return limits.maxNodes > 0; }
+    inline bool useMateLimit() { return limits.mate > 0; }
+
+    // Mate in N moves is found at ply 2N-1, past this ply the mate would be too long
+    inline bool pastMateLimit(int ply) { return useMateLimit() && ply >= 2 * limits.mate; }
+    inline bool mateFound(Score score) { return useMateLimit() && score >= SCORE_MATE - 2 * limits.mate + 1; }
+    inline bool mateDepthReached(int depth) { return useMateLimit() && depth >= 2 * limits.mate; }
 
     inline bool shouldStop() {
         // Check time every 1024 nodes for performance reason
         if (nbNodes % 1024 != 0)  return false;
+
+        // While pondering we search until ponderhit or stop
+        if (pondering) return false;
         
-        TimeMs elapsed = now() - startTime;
+        TimeMs elapsed = getClockElapsed();
 
         if (useTournamentTime() && elapsed >= hardTimeLimit)
             return true;
@@ -65,7 +88,9 @@ struct SearchData {
     }
 
     inline bool shouldStopSoft() {
-        TimeMs elapsed = now() - startTime;
+        if (pondering) return false;
+
+        TimeMs elapsed = getClockElapsed();
         
         if (useTournamentTime() && elapsed >= softTimeLimit)
             return true;
@@ -79,13 +104,16 @@ struct SearchData {
     SearchLimits limits;
     size_t nbNodes;
     int selDepth;
+    bool pondering;
 
     TimeMs startTime;
+    TimeMs clockStart;
     TimeMs lastCheck;
     TimeMs softTimeLimit;
     TimeMs hardTimeLimit;
 
-    MoveHistory moveHistory;
+    MoveHistory &moveHistory; // Owned by the engine, kept between the searches of a game
+    MoveArena moveArena;
 
     Node nodes[MAX_PLY+1];
 };
@@ -111,36 +139,48 @@ enum class NodeType {
 
 class Engine {
 public:
-    static void init();
-    
-    Engine() = default;
+    Engine(TranspositionTable &tt_ = Belette::tt): tt(tt_) { }
     virtual ~Engine() = default;
 
     inline Position &position() { return rootPosition; }
     inline const Position &position() const { return rootPosition; }
 
     void search(const SearchLimits &limits);
+    void searchSync(const SearchLimits &limits);
     void stop();
+    void ponderhit();
+    inline void clearPonderhit() { ponderhitPending = false; } // A ponderhit received while idle is not for the next search
     void waitForSearchFinish();
     inline bool isSearching() { return searching; }
     inline bool searchAborted() { return aborted; }
     inline void setHashSize(size_t size) { tt.resize(size); }
-    inline void newGame() { tt.clear(); }
+    inline void newGame() { tt.clear(); moveHistory.clear(); }
+    inline void clearHistory() { moveHistory.clear(); }
+    inline void setHistoryDecay(int decay) { historyDecay = decay; }
+    inline void setHashAging(bool aging) { hashAging = aging; } // Off when the table is shared by engines searching at the same time
+    inline void setBook(Book *book_) { book = book_; }
 
 protected:
     virtual void onSearchProgress(const SearchEvent &event) = 0;
     virtual void onSearchFinish(const SearchEvent &event) = 0;
 
 private:
-    static int LMRTable[MAX_PLY][MAX_MOVE];
-
+    TranspositionTable &tt;
+    Book *book = nullptr;
     std::unique_ptr<SearchData> sd;
+    MoveHistory moveHistory;
+    int historyDecay = 0; // 0 clears the history before each search
+    bool hashAging = true; // Each search advances the age of the transposition table
     Position rootPosition;
     bool aborted = true;
     bool searching = false;
+    std::atomic<bool> ponderhitPending = false; // Set by ponderhit(), applied by the search thread
+
+    void initSearch(const SearchLimits &limits);
 
     inline void idSearch() { rootPosition.getSideToMove() == WHITE ? idSearch<WHITE>() : idSearch<BLACK>(); }
     template<Side Me> void idSearch();
+    template<Side Me> Move getPonderMove(Move bestMove);
 
     template<Side Me, NodeType NT> Score pvSearch(Score alpha, Score beta, int depth, int ply, bool cutNode);
 
@@ -0,0 +1,85 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include "epd.h"
+
+namespace Belette {
+
+static bool isNumber(const std::string &str) {
+    return !str.empty() && std::all_of(str.begin(), str.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+static std::string trim(const std::string &str) {
+    size_t begin = str.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) return "";
+
+    size_t end = str.find_last_not_of(" \t\r\n");
+    return str.substr(begin, end - begin + 1);
+}
+
+bool parseEpd(const std::string &line, EpdEntry &entry) {
+    std::istringstream parser(line);
+    std::string token, fields[4];
+
+    entry.fen.clear();
+    entry.operations.clear();
+
+    // Piece placement, side to move, castling & en passant
+    for (int i=0; i<4; i++) {
+        if (!(parser >> fields[i])) return false;
+    }
+
+    entry.fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3];
+
+    // Optional halfmove clock & fullmove number (FEN style)
+    std::streampos afterFields = parser.tellg();
+    std::string halfMoves, fullMoves;
+    if (parser >> halfMoves >> fullMoves && isNumber(halfMoves) && isNumber(fullMoves)) {
+        entry.fen += " " + halfMoves + " " + fullMoves;
+    } else {
+        entry.fen += " 0 1";
+        parser.clear();
+        parser.seekg(afterFields);
+    }
+
+    // Operations: opcode operand ... ;
+    std::string operations;
+    std::getline(parser, operations);
+
+    std::istringstream opParser(operations);
+    std::string operation;
+    while (std::getline(opParser, operation, ';')) {
+        operation = trim(operation);
+        if (operation.empty()) continue;
+
+        size_t sep = operation.find_first_of(" \t");
+        std::string opcode = operation.substr(0, sep);
+        std::string operand = sep == std::string::npos ? "" : trim(operation.substr(sep));
+
+        if (operand.size() >= 2 && operand.front() == '"' && operand.back() == '"')
+            operand = operand.substr(1, operand.size() - 2);
+
+        entry.operations[opcode] = operand;
+    }
+
+    return true;
+}
+
+bool loadEpdFile(const std::string &filename, std::vector<EpdEntry> &entries) {
+    std::ifstream file(filename);
+    if (!file.is_open()) return false;
+
+    std::string line;
+    EpdEntry entry;
+
+    while (std::getline(file, line)) {
+        if (trim(line).empty() || line[0] == '#') continue;
+
+        if (parseEpd(line, entry))
+            entries.push_back(entry);
+    }
+
+    return true;
+}
+
+} /* namespace Belette */
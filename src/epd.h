@@ -0,0 +1,22 @@
+#ifndef EPD_H_INCLUDED
+#define EPD_H_INCLUDED
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Belette {
+
+struct EpdEntry {
+    std::string fen;
+    std::map<std::string, std::string> operations; // opcode => operand(s), ie: "bm" => "e4", "id" => "test 1"
+};
+
+// Parse an EPD (or FEN) line. Missing halfmove clock and fullmove number default to "0 1"
+bool parseEpd(const std::string &line, EpdEntry &entry);
+
+bool loadEpdFile(const std::string &filename, std::vector<EpdEntry> &entries);
+
+} /* namespace Belette */
+
+#endif /* EPD_H_INCLUDED */
@@ -1,7 +1,37 @@
+#include <array>
+#include <immintrin.h>
 #include "evaluate.h"
 
 namespace Belette {
 
+// Midgame and endgame values packed in two 16 bit lanes (mg in the low half), so both phases
+// of both sides are accumulated with a single SIMD add per piece
+using PackedScore = uint32_t;
+
+constexpr PackedScore packScore(Score mg, Score eg) {
+    return uint32_t(uint16_t(mg)) | (uint32_t(uint16_t(eg)) << 16);
+}
+
+// Material and piece square values from white point of view, black pieces are negated
+constexpr std::array<std::array<PackedScore, NB_SQUARE>, NB_PIECE> PACKED_PSQT = [] {
+    std::array<std::array<PackedScore, NB_SQUARE>, NB_PIECE> table{};
+
+    for (Side side : {WHITE, BLACK}) {
+        for (PieceType pt : {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING}) {
+            Piece pc = piece(side, pt);
+            int sign = side == WHITE ? 1 : -1;
+
+            for (Square sq=SQ_A1; sq<NB_SQUARE; ++sq) {
+                Score mg = PieceValue<MG>(pt) + PSQT[pt][MG][relativeSquare(side, sq)];
+                Score eg = PieceValue<EG>(pt) + PSQT[pt][EG][relativeSquare(side, sq)];
+                table[pc][sq] = packScore(sign * mg, sign * eg);
+            }
+        }
+    }
+
+    return table;
+}();
+
 template<Side Me, Phase P>
 Score evaluateMaterial(const Position &pos) {
     static_assert(P == MG || P == EG);
@@ -41,7 +71,7 @@ Score evaluatePSQT(const Position &pos) {
 }
 
 template<Side Me, Phase P>
-Score evaluate(const Position &pos) {
+Score evaluateReference(const Position &pos) {
     Score score = 0;
     score += evaluateMaterial<Me, P>(pos);
     score += evaluatePSQT<Me, P>(pos);
@@ -51,13 +81,32 @@ Score evaluate(const Position &pos) {
 
 template<Side Me>
 Score evaluate(const Position &pos) {
-    Score mg = evaluate<Me, MG>(pos);
-    Score eg = evaluate<Me, EG>(pos);
+    __m128i acc = _mm_setzero_si128();
+
+    Bitboard pieces = pos.getPiecesBB();
+    bitscan_loop(pieces) {
+        Square sq = bitscan(pieces);
+        acc = _mm_add_epi16(acc, _mm_cvtsi32_si128(int(PACKED_PSQT[pos.getPieceAt(sq)][sq])));
+    }
+
+    if constexpr (Me == BLACK)
+        acc = _mm_sub_epi16(_mm_setzero_si128(), acc);
+
+    // Phase blend in one multiply-add: mg*phase + eg*(PHASE_TOTAL - phase)
+    int phase = gamePhase(pos);
+    __m128i weights = _mm_cvtsi32_si128(int(packScore(phase, PHASE_TOTAL - phase)));
+    Score score = _mm_cvtsi128_si32(_mm_madd_epi16(acc, weights)) / PHASE_TOTAL;
+    score += Tempo;
+
+    return score;
+}
+
+template<Side Me>
+Score evaluateReference(const Position &pos) {
+    Score mg = evaluateReference<Me, MG>(pos);
+    Score eg = evaluateReference<Me, EG>(pos);
 
-    int phase = 4 * pos.nbPieceTypes(QUEEN)
-              + 2 * pos.nbPieceTypes(ROOK)
-              + 1 * pos.nbPieceTypes(KNIGHT)
-              + 1 * pos.nbPieceTypes(BISHOP);
+    int phase = gamePhase(pos);
 
     Score score = (mg*phase +  eg*(PHASE_TOTAL - phase)) / PHASE_TOTAL;
     score += Tempo;
@@ -67,5 +116,7 @@ Score evaluate(const Position &pos) {
 
 template Score evaluate<WHITE>(const Position &pos);
 template Score evaluate<BLACK>(const Position &pos);
+template Score evaluateReference<WHITE>(const Position &pos);
+template Score evaluateReference<BLACK>(const Position &pos);
 
 } /* namespace Belette */
\ No newline at end of file
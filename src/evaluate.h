@@ -8,6 +8,7 @@ namespace Belette {
 
 constexpr Score Tempo = 10;
 
+// Material and piece square values can be tuned on a dataset with the tune command, which prints them in this format
 constexpr Score PawnValueMg = 85;
 constexpr Score PawnValueEg = 100;
 
@@ -190,6 +191,14 @@ constexpr Score PSQT[NB_PIECE_TYPE][NB_PHASE][NB_SQUARE] = {
     }
 };
 
+// PHASE_TOTAL for the starting material, can go above with promotions
+inline int gamePhase(const Position &pos) {
+    return 4 * pos.nbPieceTypes(QUEEN)
+         + 2 * pos.nbPieceTypes(ROOK)
+         + 1 * pos.nbPieceTypes(KNIGHT)
+         + 1 * pos.nbPieceTypes(BISHOP);
+}
+
 template<Side Me>
 Score evaluate(const Position &pos);
 
@@ -197,6 +206,14 @@ inline Score evaluate(const Position &pos) {
     return pos.getSideToMove() == WHITE ? evaluate<WHITE>(pos) : evaluate<BLACK>(pos);
 };
 
+// Scalar evaluation walking the pieces once per phase, kept to check and benchmark evaluate() (bench eval)
+template<Side Me>
+Score evaluateReference(const Position &pos);
+
+inline Score evaluateReference(const Position &pos) {
+    return pos.getSideToMove() == WHITE ? evaluateReference<WHITE>(pos) : evaluateReference<BLACK>(pos);
+};
+
 } /* namespace Belette */
 
 #endif /* EVALUATE_H_INCLUDED */
@@ -0,0 +1,66 @@
+#ifndef GAME_H_INCLUDED
+#define GAME_H_INCLUDED
+
+#include <random>
+#include "chess.h"
+#include "position.h"
+#include "movegen.h"
+
+namespace Belette {
+
+enum GameResult {
+    RESULT_NONE,
+    RESULT_WHITE_WIN,
+    RESULT_BLACK_WIN,
+    RESULT_DRAW
+};
+
+// Result of the game according to the rules (checkmate, stalemate, fifty move, repetition, insufficient material)
+inline GameResult getGameResult(const Position &pos) {
+    bool hasLegalMove = !enumerateLegalMoves(pos, [](Move m) { return false; });
+
+    if (!hasLegalMove) {
+        if (!pos.inCheck()) return RESULT_DRAW;
+        return pos.getSideToMove() == WHITE ? RESULT_BLACK_WIN : RESULT_WHITE_WIN;
+    }
+
+    if (pos.isFiftyMoveDraw() || pos.isMaterialDraw() || pos.isRepetitionDraw())
+        return RESULT_DRAW;
+
+    return RESULT_NONE;
+}
+
+// Random opening of a few legal moves, the same seed gives the same opening
+inline bool randomOpening(Position &pos, int nbPlies, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+
+    for (int attempt = 0; attempt < 100; attempt++) {
+        pos.setFromFEN(STARTPOS_FEN);
+
+        int ply;
+        for (ply = 0; ply < nbPlies; ply++) {
+            MoveList moves;
+            generateLegalMoves(pos, moves);
+            if (moves.empty()) break;
+
+            pos.doMove(moves[rng() % moves.size()]);
+        }
+
+        if (ply == nbPlies && getGameResult(pos) == RESULT_NONE) return true;
+    }
+
+    return false;
+}
+
+inline const char* formatResult(GameResult result) {
+    switch (result) {
+        case RESULT_WHITE_WIN: return "1-0";
+        case RESULT_BLACK_WIN: return "0-1";
+        case RESULT_DRAW: return "1/2-1/2";
+        default: return "*";
+    }
+}
+
+} /* namespace Belette */
+
+#endif /* GAME_H_INCLUDED */
@@ -6,15 +6,26 @@
 #include "bitboard.h"
 #include "test.h"
 #include "perft.h"
-#include "zobrist.h"
+#include "cpu.h"
+#include "tt.h"
 
 using namespace Belette;
 
 int main(int argc, char* argv[])
 {
-    Engine::init();
+#ifdef LAUNCHER
+    CPU::launchBest(argv);
+#endif
+
+    std::string missing;
+    if (!CPU::isSupported(missing)) {
+        std::cerr << "This cpu does not support " << missing << " used by this " << CPU::buildArch() << " build, "
+                  << "use a build for the " << CPU::bestArch() << " level (make ARCH=" << CPU::bestArch() << ")" << std::endl;
+        return 1;
+    }
+
     BB::init();
-    Zobrist::init();
+    tt.resize(TT_DEFAULT_SIZE);
 
     Uci uci;
     uci.loop(argc, argv);
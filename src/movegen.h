@@ -16,6 +16,7 @@ enum MoveGenType {
     QUIET_MOVES = 1,
     TACTICAL_MOVES = 2,
     ALL_MOVES = QUIET_MOVES | TACTICAL_MOVES,
+    QUIET_CHECKS = 4, // Quiet moves giving check (promotions and castling excluded), only when not in check
 };
 
 #define CALL_HANDLER(...) if (!handler(__VA_ARGS__)) return false
@@ -366,10 +367,101 @@ inline bool enumerateQueenSliderMoves(const Position &pos, Bitboard source, cons
     return true;
 }
 
+template<Side Me, typename Handler>
+inline bool enumerateQuietChecks(const Position &pos, const Handler& handler) {
+    constexpr Side Opp = ~Me;
+    constexpr Bitboard Rank3 = (Me == WHITE) ? Rank3BB : Rank6BB;
+    constexpr Bitboard Rank7 = (Me == WHITE) ? Rank7BB : Rank2BB;
+    constexpr Direction Up = (Me == WHITE) ? UP : DOWN;
+
+    assert(!pos.inCheck());
+
+    Square oppKing = pos.getKingSquare(Opp);
+    Bitboard occupied = pos.getPiecesBB();
+    Bitboard emptyBB = pos.getEmptyBB();
+    Bitboard pinDiag = pos.pinDiag();
+    Bitboard pinOrtho = pos.pinOrtho();
+    Bitboard discoverers = pos.discoverers();
+
+    // Only called for discoverers: the move gives check unless it stays on the line
+    auto discoversCheck = [&](Square from, Square to) {
+        return !(betweenBB(oppKing, from) & bb(to)) && !(betweenBB(oppKing, to) & bb(from));
+    };
+
+    // Discoverers try all their quiet moves, other pieces only the check squares
+    auto enumerateChecks = [&](Square from, Bitboard dest, PieceType pt) {
+        if (!(discoverers & bb(from))) dest &= pos.checkSquares(pt);
+
+        bitscan_loop(dest) {
+            Square to = bitscan(dest);
+            if (!(pos.checkSquares(pt) & bb(to)) && !discoversCheck(from, to)) continue;
+            CALL_HANDLER(makeMove(from, to));
+        }
+
+        return true;
+    };
+
+    // Pawn pushes
+    {
+        Bitboard pawns = pos.getPiecesBB(Me, PAWN) & ~Rank7 & ~pinDiag;
+        Bitboard singlePushes = (shift<Up>(pawns & ~pinOrtho) | (shift<Up>(pawns & pinOrtho) & pinOrtho)) & emptyBB;
+        Bitboard doublePushes = shift<Up>(singlePushes & Rank3) & emptyBB;
+
+        singlePushes &= pos.checkSquares(PAWN) | shift<Up>(discoverers);
+        doublePushes &= pos.checkSquares(PAWN) | shift<Up>(shift<Up>(discoverers));
+
+        bitscan_loop(singlePushes) {
+            Square to = bitscan(singlePushes);
+            Square from = to - Up;
+            if (!(pos.checkSquares(PAWN) & bb(to)) && !discoversCheck(from, to)) continue;
+            CALL_HANDLER(makeMove(from, to));
+        }
+
+        bitscan_loop(doublePushes) {
+            Square to = bitscan(doublePushes);
+            Square from = to - Up - Up;
+            if (!(pos.checkSquares(PAWN) & bb(to)) && !discoversCheck(from, to)) continue;
+            CALL_HANDLER(makeMove(from, to));
+        }
+    }
+
+    Bitboard pieces = pos.getPiecesBB(Me, KNIGHT) & ~(pinDiag | pinOrtho);
+    bitscan_loop(pieces) {
+        Square from = bitscan(pieces);
+        CALL_ENUMERATOR(enumerateChecks(from, attacks<KNIGHT>(from) & emptyBB, KNIGHT));
+    }
+
+    pieces = pos.getPiecesBB(Me, BISHOP, QUEEN) & ~pinOrtho;
+    bitscan_loop(pieces) {
+        Square from = bitscan(pieces);
+        Bitboard dest = attacks<BISHOP>(from, occupied) & emptyBB;
+        if (bb(from) & pinDiag) dest &= pinDiag;
+        CALL_ENUMERATOR(enumerateChecks(from, dest, pieceType(pos.getPieceAt(from))));
+    }
+
+    pieces = pos.getPiecesBB(Me, ROOK, QUEEN) & ~pinDiag;
+    bitscan_loop(pieces) {
+        Square from = bitscan(pieces);
+        Bitboard dest = attacks<ROOK>(from, occupied) & emptyBB;
+        if (bb(from) & pinOrtho) dest &= pinOrtho;
+        CALL_ENUMERATOR(enumerateChecks(from, dest, pieceType(pos.getPieceAt(from))));
+    }
+
+    // The king can only give a discovered check
+    Square king = pos.getKingSquare(Me);
+    if (discoverers & bb(king)) {
+        CALL_ENUMERATOR(enumerateChecks(king, attacks<KING>(king) & emptyBB & ~pos.checkedSquares(), KING));
+    }
+
+    return true;
+}
+
 template<Side Me, MoveGenType MGType = ALL_MOVES, typename Handler>
 inline bool enumerateLegalMoves(const Position &pos, const Handler& handler) {
     assert(pos.nbCheckers() < 3);
 
+    if constexpr (MGType == QUIET_CHECKS) return enumerateQuietChecks<Me, Handler>(pos, handler);
+
     switch(pos.nbCheckers()) {
         case 0:
             CALL_ENUMERATOR(enumeratePawnMoves<Me, false, MGType, Handler>(pos, pos.getPiecesBB(Me, PAWN), handler));
@@ -403,6 +495,111 @@ inline bool enumerateLegalMoves(const Position &pos, const Handler& handler) {
             : enumerateLegalMoves<BLACK, MGType, Handler>(pos, handler);
 }
 
+// Legal move count from popcounts of the destination sets (same masks as the enumerators), StopAtFirst returns as soon as one move is found
+template<Side Me, bool InCheck, bool StopAtFirst>
+inline int countLegalMoves(const Position &pos) {
+    constexpr Side Opp = ~Me;
+    constexpr Bitboard Rank3 = (Me == WHITE) ? Rank3BB : Rank6BB;
+    constexpr Bitboard Rank7 = (Me == WHITE) ? Rank7BB : Rank2BB;
+    constexpr Direction Up = (Me == WHITE) ? UP : DOWN;
+    constexpr Direction UpLeft = (Me == WHITE) ? UP_LEFT : DOWN_RIGHT;
+    constexpr Direction UpRight = (Me == WHITE) ? UP_RIGHT : DOWN_LEFT;
+
+    #define COUNT_MOVES(dest, n) { count += (n) * popcount(dest); if (StopAtFirst && count) return count; }
+
+    int count = 0;
+    Bitboard occupied = pos.getPiecesBB();
+    Bitboard pinOrtho = pos.pinOrtho();
+    Bitboard pinDiag = pos.pinDiag();
+    Bitboard target = ~pos.getPiecesBB(Me);
+    if constexpr (InCheck) target &= pos.checkMask();
+
+    // King first, it is the most likely to have a move
+    COUNT_MOVES(attacks<KING>(pos.getKingSquare(Me)) & ~pos.getPiecesBB(Me) & ~pos.checkedSquares(), 1);
+
+    if (InCheck && pos.nbCheckers() > 1) return count;
+
+    Bitboard knights = pos.getPiecesBB(Me, KNIGHT) & ~(pinDiag | pinOrtho);
+    bitscan_loop(knights) {
+        COUNT_MOVES(attacks<KNIGHT>(bitscan(knights)) & target, 1);
+    }
+
+    // Pawns
+    {
+        Bitboard pawns = pos.getPiecesBB(Me, PAWN);
+        Bitboard emptyBB = pos.getEmptyBB();
+        Bitboard oppPiecesBB = pos.getPiecesBB(Opp);
+
+        Bitboard pushers = pawns & ~pinDiag;
+        Bitboard pushes = (shift<Up>(pushers & ~pinOrtho) | (shift<Up>(pushers & pinOrtho) & pinOrtho)) & emptyBB;
+        Bitboard doublePushes = shift<Up>(pushes & Rank3) & emptyBB;
+
+        Bitboard capturers = pawns & ~pinOrtho;
+        Bitboard capL = (shift<UpLeft>(capturers & ~pinDiag) | (shift<UpLeft>(capturers & pinDiag) & pinDiag)) & oppPiecesBB;
+        Bitboard capR = (shift<UpRight>(capturers & ~pinDiag) | (shift<UpRight>(capturers & pinDiag) & pinDiag)) & oppPiecesBB;
+
+        if constexpr (InCheck) {
+            pushes &= pos.checkMask();
+            doublePushes &= pos.checkMask();
+            capL &= pos.checkMask();
+            capR &= pos.checkMask();
+        }
+
+        // Moves to the last rank are 4 promotions
+        constexpr Bitboard PromotionRank = shift<Up>(Rank7);
+        COUNT_MOVES(pushes & ~PromotionRank, 1);
+        COUNT_MOVES(doublePushes, 1);
+        COUNT_MOVES(capL & ~PromotionRank, 1);
+        COUNT_MOVES(capR & ~PromotionRank, 1);
+        COUNT_MOVES(pushes & PromotionRank, 4);
+        COUNT_MOVES(capL & PromotionRank, 4);
+        COUNT_MOVES(capR & PromotionRank, 4);
+    }
+
+    Bitboard bishops = pos.getPiecesBB(Me, BISHOP, QUEEN) & ~pinOrtho;
+    bitscan_loop(bishops) {
+        Square from = bitscan(bishops);
+        Bitboard dest = attacks<BISHOP>(from, occupied) & target;
+        if (bb(from) & pinDiag) dest &= pinDiag;
+        COUNT_MOVES(dest, 1);
+    }
+
+    Bitboard rooks = pos.getPiecesBB(Me, ROOK, QUEEN) & ~pinDiag;
+    bitscan_loop(rooks) {
+        Square from = bitscan(rooks);
+        Bitboard dest = attacks<ROOK>(from, occupied) & target;
+        if (bb(from) & pinOrtho) dest &= pinOrtho;
+        COUNT_MOVES(dest, 1);
+    }
+
+    #undef COUNT_MOVES
+
+    // Rare special moves are enumerated
+    auto counter = [&](Move) { count++; return !StopAtFirst; };
+    enumeratePawnEnpassantMoves<Me, InCheck>(pos, pos.getPiecesBB(Me, PAWN), counter);
+    if constexpr (!InCheck) enumerateCastlingMoves<Me>(pos, counter);
+
+    return count;
+}
+
+template<Side Me>
+inline int countLegalMoves(const Position &pos) {
+    return pos.inCheck() ? countLegalMoves<Me, true, false>(pos) : countLegalMoves<Me, false, false>(pos);
+}
+
+template<Side Me>
+inline bool hasLegalMove(const Position &pos) {
+    return pos.inCheck() ? countLegalMoves<Me, true, true>(pos) : countLegalMoves<Me, false, true>(pos);
+}
+
+inline int countLegalMoves(const Position &pos) {
+    return pos.getSideToMove() == WHITE ? countLegalMoves<WHITE>(pos) : countLegalMoves<BLACK>(pos);
+}
+
+inline bool hasLegalMove(const Position &pos) {
+    return pos.getSideToMove() == WHITE ? hasLegalMove<WHITE>(pos) : hasLegalMove<BLACK>(pos);
+}
+
 inline void generateLegalMoves(const Position &pos, MoveList &moves) {
     enumerateLegalMoves(pos, [&](Move m) {
         moves.push_back(m); return true;
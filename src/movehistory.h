@@ -16,6 +16,23 @@ class MoveHistory {
 public:
     MoveHistory(): counterMoves{}, killerMoves{}, history{} { }
 
+    inline void clear() { *this = MoveHistory(); }
+
+    // Called at the start of each search of a game. With a decay, history from the previous moves is kept divided
+    // by it and killers are cleared because the plies don't match anymore. Without, everything is cleared
+    inline void newSearch(int decay) {
+        if (decay <= 0) {
+            clear();
+            return;
+        }
+
+        for (auto &sideHistory : history) {
+            for (auto &entry : sideHistory) entry /= decay;
+        }
+
+        for (int ply = 0; ply < MAX_PLY + 1; ply++) clearKillers(ply);
+    }
+
     inline void clearKillers(int ply) {
         assert(ply >= 0 && ply < MAX_PLY + 1);
         killerMoves[ply][0] = killerMoves[ply][1] = MOVE_NONE;
@@ -39,6 +56,9 @@ public:
         return history[Me][moveFromTo(m)];
     }
 
+    template<Side Me>
+    inline const MoveScore *historyTable() const { return history[Me]; }
+
     template<Side Me>
     inline void update(const Position& pos, Move bestMove, int ply, int depth, const PartialMoveList& quietMoves) {
         if (!pos.isTactical(bestMove)) {
@@ -2,7 +2,9 @@
 #define MOVEPICKER_H_INCLUDED
 
 #include <cstdint>
+#include <cstddef>
 #include <algorithm>
+#include <immintrin.h>
 #include "fixed_vector.h"
 #include "chess.h"
 #include "position.h"
@@ -10,6 +12,7 @@
 #include "movehistory.h"
 #include "evaluate.h"
 #include "tt.h"
+#include "stats.h"
 
 namespace Belette {
 
@@ -25,24 +28,96 @@ struct ScoredMove {
 
     MoveScore score;
     Move move;
+    int16_t see; // Static exchange evaluation, only computed for tacticals
 };
 
-using ScoredMoveList = fixed_vector<ScoredMove, MAX_MOVE, uint8_t>;
+// Scored moves of all the plies of a search in one contiguous buffer used as a stack: each MovePicker
+// only takes the slots of the moves it generates, on top of the ones of its parent
+class MoveArena {
+public:
+    inline ScoredMove *top() const { return current; }
+    inline void setTop(ScoredMove *top) { assert(top >= moves && top <= moves + Size); current = top; }
+
+private:
+    static constexpr int Size = (MAX_PLY + 1) * MAX_MOVE;
+
+    ScoredMove moves[Size];
+    ScoredMove *current = moves;
+};
+
+// Moves of one MovePicker in the arena. The top of the arena follows the end of the list, so the plies
+// searched from the handler allocate after it, and the slots are released when the list goes out of scope
+class ArenaMoveList {
+public:
+    inline ArenaMoveList(MoveArena &arena_): arena(arena_), first(arena_.top()), last(arena_.top()) { }
+    inline ~ArenaMoveList() { arena.setTop(first); }
+    ArenaMoveList(const ArenaMoveList&) = delete;
+    ArenaMoveList& operator=(const ArenaMoveList&) = delete;
+
+    inline ScoredMove *begin() { return first; }
+    inline ScoredMove *end() { return last; }
+    inline size_t size() const { return last - first; }
+
+    inline void resize(size_t s) {
+        assert(first + s <= last);
+        last = first + s;
+        arena.setTop(last);
+    }
+
+    inline void push_back(const ScoredMove& e) {
+        assert(arena.top() == last); // A child ply still owns the slots after the list
+        *last = e;
+        arena.setTop(++last);
+    }
+
+    template<typename Compare>
+    inline void insert_sorted(const ScoredMove& e, Compare comp) {
+        assert(arena.top() == last); // A child ply still owns the slots after the list
+        ScoredMove *cur = last;
+
+        for (; cur != first && comp(e, *(cur - 1)); cur--) {
+            *cur = *(cur - 1);
+        }
+
+        *cur = e;
+        arena.setTop(++last);
+    }
+
+private:
+    MoveArena &arena;
+    ScoredMove *first;
+    ScoredMove *last;
+};
+
+// Stable, gives the same order as inserting the moves one by one with insert_sorted
+template<typename Compare>
+inline void insertionSort(ScoredMove *begin, ScoredMove *end, Compare comp) {
+    for (ScoredMove *it = begin; it != end; it++) {
+        ScoredMove e = *it, *cur = it;
+
+        for (; cur != begin && comp(e, *(cur - 1)); cur--) {
+            *cur = *(cur - 1);
+        }
+
+        *cur = e;
+    }
+}
 
 enum MovePickerType {
     MAIN,
-    QUIESCENCE
+    QUIESCENCE,
+    QUIESCENCE_CHECKS // Quiescence followed by quiet checks
 };
 
 class MovePicker {
 public:
-    MovePicker(): pos(nullptr), moveHistory(nullptr) { }
-    MovePicker(const Position &pos_, Move ttMove_ = MOVE_NONE)
-    : pos(&pos_),  moveHistory(nullptr), ttMove(ttMove_), refutations{}
+    MovePicker(): pos(nullptr), arena(nullptr), moveHistory(nullptr), tt(Belette::tt) { }
+    MovePicker(const Position &pos_, MoveArena &arena_, Move ttMove_ = MOVE_NONE, const TranspositionTable &tt_ = Belette::tt)
+    : pos(&pos_), arena(&arena_), moveHistory(nullptr), tt(tt_), ttMove(ttMove_), refutations{}
     { }
 
-    MovePicker(const Position &pos_, Move ttMove_, const MoveHistory* moveHistory_, int ply_)
-    : pos(&pos_), moveHistory(moveHistory_), ttMove(ttMove_),
+    MovePicker(const Position &pos_, MoveArena &arena_, Move ttMove_, const MoveHistory* moveHistory_, int ply_, const TranspositionTable &tt_ = Belette::tt)
+    : pos(&pos_), arena(&arena_), moveHistory(moveHistory_), tt(tt_), ttMove(ttMove_),
       refutations{moveHistory->getKiller<0>(ply_), moveHistory->getKiller<1>(ply_), moveHistory->getCounter(pos_)}
     {
         assert(refutations[0] != refutations[1] || refutations[0] == MOVE_NONE);
@@ -54,20 +129,31 @@ public:
     template<MovePickerType Type, typename Handler>
     inline bool enumerate(const Handler &handler) { return pos->getSideToMove() == WHITE ? enumerate<Type, WHITE, Handler>(handler) : enumerate<Type, BLACK, Handler>(handler); }
 
+    // SEE of the current move, reuses the value computed to order tacticals
+    inline bool see(Move m, int threshold) const { return m == seeMove ? seeScore >= threshold : pos->see(m, threshold); }
+
+    // Score a list of quiet moves, 8 at a time with AVX2 when available: history is gathered, piece type tables
+    // (threats, check squares) are looked up with permutes
+    template<Side Me> inline void scoreQuiets(ScoredMove *begin, ScoredMove *end);
+    template<Side Me> inline MoveScore scoreQuiet(Move m);
+
 private:
     const Position* const pos;
+    MoveArena* const arena;
     const MoveHistory* const moveHistory;
+    const TranspositionTable &tt;
     Move ttMove;
     Move refutations[3];
+    Move seeMove = MOVE_NONE;
+    Score seeScore = 0;
 
     template<Side Me> inline MoveScore scoreEvasion(Move m);
     template<Side Me> inline MoveScore scoreTactical(Move m);
-    template<Side Me> inline MoveScore scoreQuiet(Move m);
 };
 
 template<MovePickerType Type, Side Me, typename Handler>
 bool MovePicker::enumerate(const Handler &handler) {
-    assert(pos != nullptr);
+    assert(pos != nullptr && arena != nullptr);
     assert(pos->getSideToMove() == Me);
     
     bool skipQuiets = false;
@@ -76,10 +162,11 @@ bool MovePicker::enumerate(const Handler &handler) {
 
     // TT Move
     if (pos->isLegal<Me>(ttMove)) {
+        STATS_INC(STAT_MP_TT_MOVES);
         CALL_HANDLER(ttMove, skipQuiets);
     }
     
-    ScoredMoveList moves;
+    ArenaMoveList moves(*arena);
     ScoredMove *current, *endBadTacticals, *beginQuiets, *endBadQuiets;
 
     auto compare = [](const ScoredMove& a, const ScoredMove& b) { return a.score > b.score; };
@@ -98,6 +185,7 @@ bool MovePicker::enumerate(const Handler &handler) {
         });
 
         for (auto m : moves) {
+            STATS_INC(STAT_MP_EVASIONS);
             CALL_HANDLER(m.move, skipQuiets);
         }
 
@@ -118,18 +206,34 @@ bool MovePicker::enumerate(const Handler &handler) {
     });
 
     for (current = endBadTacticals = moves.begin(); current != moves.end(); current++) {
+        current->see = int16_t(pos->seeValue(current->move));
+
         if constexpr(Type == MAIN) { // For quiescence prunning of bad captures is done in search
-            if (!pos->see(current->move, -50)) { // Allow Bishop takes Knight
+            if (current->see < -50) { // Allow Bishop takes Knight
                 *endBadTacticals++ = *current;
                 continue;
             }
         }
 
+        seeMove = current->move;
+        seeScore = current->see;
+        STATS_INC(STAT_MP_GOOD_TACTICALS);
         CALL_HANDLER(current->move, skipQuiets);
     }
 
+    // Quiet checks, in generation order
+    if constexpr(Type == QUIESCENCE_CHECKS) {
+        CALL_ENUMERATOR(enumerateLegalMoves<Me, QUIET_CHECKS>(*pos, [&](Move m) {
+            if (m == ttMove) return true; // continue;
+
+            STATS_INC(STAT_MP_QUIET_CHECKS);
+            CALL_HANDLER(m, skipQuiets);
+            return true;
+        }));
+    }
+
     // Stop here for Quiescence
-    if constexpr(Type == QUIESCENCE) return true;
+    if constexpr(Type != MAIN) return true;
 
     if (moveHistory != nullptr) [[likely]] {
         tt.prefetch(pos->getHashAfter(refutations[0]));
@@ -138,16 +242,19 @@ bool MovePicker::enumerate(const Handler &handler) {
         
         // Killer 1
         if (refutations[0] != ttMove && !pos->isTactical(refutations[0]) && pos->isLegal<Me>(refutations[0])) {
+            STATS_INC(STAT_MP_REFUTATIONS);
             CALL_HANDLER(refutations[0], skipQuiets);
         }
 
         // Killer 2
         if (refutations[1] != ttMove && !pos->isTactical(refutations[1]) && pos->isLegal<Me>(refutations[1])) {
+            STATS_INC(STAT_MP_REFUTATIONS);
             CALL_HANDLER(refutations[1], skipQuiets);
         }
 
         // Counter
         if (refutations[2] != ttMove && !pos->isTactical(refutations[2]) && refutations[2] != refutations[0] && refutations[2] != refutations[1] && pos->isLegal<Me>(refutations[2])) {
+            STATS_INC(STAT_MP_REFUTATIONS);
             CALL_HANDLER(refutations[2], skipQuiets);
         }
     }
@@ -163,12 +270,16 @@ bool MovePicker::enumerate(const Handler &handler) {
         if (moves.size() < 48)
             tt.prefetch(pos->getHashAfter(m));
 
-        ScoredMove newMove = ScoredMove(m, scoreQuiet<Me>(m));
-        moves.insert_sorted(newMove, compare);
+        moves.push_back(ScoredMove(m, 0));
         
         return true;
     });
 
+    // Quiets are scored in one pass once generated, then sorted in place after the bad tacticals. Sorting them with
+    // the bad tacticals would move quiets in front of them, where they are played with a stale SEE value
+    scoreQuiets<Me>(beginQuiets, moves.end());
+    insertionSort(beginQuiets, moves.end(), compare);
+
     // Good quiets
     for (current = endBadQuiets = beginQuiets; current != moves.end() && !skipQuiets; current++) {
         if (current->score < -4000) {
@@ -176,18 +287,23 @@ bool MovePicker::enumerate(const Handler &handler) {
             continue;
         }
 
+        STATS_INC(STAT_MP_GOOD_QUIETS);
         CALL_HANDLER(current->move, skipQuiets);
     }
 
     // Bad tacticals
     for (current = moves.begin(); current != endBadTacticals; current++) {
         tt.prefetch(pos->getHashAfter(current->move));
+        seeMove = current->move;
+        seeScore = current->see;
+        STATS_INC(STAT_MP_BAD_TACTICALS);
         CALL_HANDLER(current->move, skipQuiets);
     }
 
     // Bad quiets
     for (current = beginQuiets; current != endBadQuiets && !skipQuiets; current++) {
         tt.prefetch(pos->getHashAfter(current->move));
+        STATS_INC(STAT_MP_BAD_QUIETS);
         CALL_HANDLER(current->move, skipQuiets);
     }
 
@@ -211,6 +327,102 @@ MoveScore MovePicker::scoreTactical(Move m) {
     return PieceValue<MG>(pos->getPieceAt(moveTo(m))) - (int)pieceType(pos->getPieceAt(moveFrom(m))); // MVV-LVA
 }
 
+template<Side Me>
+void MovePicker::scoreQuiets(ScoredMove *begin, ScoredMove *end) {
+    ScoredMove *current = begin;
+
+#ifdef __AVX2__
+    static_assert(sizeof(ScoredMove) == 8 && offsetof(ScoredMove, score) == 0 && offsetof(ScoredMove, move) == 4);
+
+    // Bitboards are looked up as two 32 bit halves, tables indexed by piece type with permutes
+    auto splitTable = [](const Bitboard *table, __m256i &lo, __m256i &hi) {
+        alignas(32) int l[8] = {}, h[8] = {};
+        for (int pt = PAWN; pt < NB_PIECE_TYPE; pt++) {
+            l[pt] = int(table[pt]);
+            h[pt] = int(table[pt] >> 32);
+        }
+        lo = _mm256_load_si256(reinterpret_cast<const __m256i *>(l));
+        hi = _mm256_load_si256(reinterpret_cast<const __m256i *>(h));
+    };
+
+    // All bits set in the lanes where bit sq of the bitboard is set
+    auto testBit = [](__m256i lo, __m256i hi, __m256i sq) {
+        __m256i half = _mm256_blendv_epi8(lo, hi, _mm256_cmpgt_epi32(sq, _mm256_set1_epi32(31)));
+        __m256i shift = _mm256_sub_epi32(_mm256_set1_epi32(31), _mm256_and_si256(sq, _mm256_set1_epi32(31)));
+        return _mm256_srai_epi32(_mm256_sllv_epi32(half, shift), 31);
+    };
+
+    Bitboard checkSquares[NB_PIECE_TYPE];
+    for (int pt = 0; pt < NB_PIECE_TYPE; pt++) checkSquares[pt] = pos->checkSquares(PieceType(pt));
+
+    __m256i threatsLo, threatsHi, checksLo, checksHi;
+    splitTable(pos->threatsTable(), threatsLo, threatsHi);
+    splitTable(checkSquares, checksLo, checksHi);
+
+    const __m256i threatenedValue = _mm256_setr_epi32(PieceThreatenedValue[0], PieceThreatenedValue[1], PieceThreatenedValue[2],
+        PieceThreatenedValue[3], PieceThreatenedValue[4], PieceThreatenedValue[5], PieceThreatenedValue[6], 0);
+    const __m256i discoverersLo = _mm256_set1_epi32(int(pos->discoverers()));
+    const __m256i discoverersHi = _mm256_set1_epi32(int(pos->discoverers() >> 32));
+    const __m256i squareMask = _mm256_set1_epi32(63);
+    const int *history = moveHistory != nullptr ? moveHistory->historyTable<Me>() : nullptr;
+
+    for (; end - current >= 8; current += 8) {
+        // Moves are the odd 32 bit words of the scored moves
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(current));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(current + 4));
+        __m256i moves = _mm256_castps_si256(_mm256_shuffle_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(b), _MM_SHUFFLE(3, 1, 3, 1)));
+        moves = _mm256_and_si256(_mm256_permute4x64_epi64(moves, _MM_SHUFFLE(3, 1, 2, 0)), _mm256_set1_epi32(0xFFFF));
+
+        __m256i from = _mm256_and_si256(_mm256_srli_epi32(moves, 6), squareMask);
+        __m256i to = _mm256_and_si256(moves, squareMask);
+
+        // Type of the moving piece
+        __m256i pt = _mm256_setzero_si256();
+        for (PieceType p : {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING}) {
+            Bitboard pieces = pos->getPiecesBB(Me, p);
+            __m256i isType = testBit(_mm256_set1_epi32(int(pieces)), _mm256_set1_epi32(int(pieces >> 32)), from);
+            pt = _mm256_or_si256(pt, _mm256_and_si256(isType, _mm256_set1_epi32(p)));
+        }
+
+        __m256i score = _mm256_sub_epi32(_mm256_set1_epi32(NB_PIECE_TYPE), pt);
+
+        // Threatened piece moving to a safe square
+        __m256i threatLo = _mm256_permutevar8x32_epi32(threatsLo, pt), threatHi = _mm256_permutevar8x32_epi32(threatsHi, pt);
+        __m256i escapes = _mm256_andnot_si256(testBit(threatLo, threatHi, to), testBit(threatLo, threatHi, from));
+        score = _mm256_add_epi32(score, _mm256_and_si256(escapes, _mm256_permutevar8x32_epi32(threatenedValue, pt)));
+
+        if (history != nullptr) [[likely]]
+            score = _mm256_add_epi32(score, _mm256_i32gather_epi32(history, _mm256_and_si256(moves, _mm256_set1_epi32(0xFFF)), 4));
+
+        // Direct checks
+        __m256i checks = testBit(_mm256_permutevar8x32_epi32(checksLo, pt), _mm256_permutevar8x32_epi32(checksHi, pt), to);
+        score = _mm256_add_epi32(score, _mm256_and_si256(checks, _mm256_set1_epi32(10000)));
+
+        __m256i type = _mm256_and_si256(moves, _mm256_set1_epi32(3 << 14));
+        __m256i promotion = _mm256_cmpeq_epi32(type, _mm256_set1_epi32(PROMOTION));
+        score = _mm256_blendv_epi8(score, _mm256_set1_epi32(-10000), promotion);
+
+        // Scores are the even 32 bit words
+        a = _mm256_blend_epi32(a, _mm256_permutevar8x32_epi32(score, _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3)), 0x55);
+        b = _mm256_blend_epi32(b, _mm256_permutevar8x32_epi32(score, _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7)), 0x55);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(current), a);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(current + 4), b);
+
+        // Discovered checks and castling are rare, they are scored again by scoreQuiet
+        __m256i scalar = _mm256_or_si256(testBit(discoverersLo, discoverersHi, from), _mm256_cmpeq_epi32(type, _mm256_set1_epi32(CASTLING)));
+        int lanes = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_andnot_si256(promotion, scalar)));
+        for (; lanes; lanes &= lanes - 1) {
+            ScoredMove &m = current[__builtin_ctz(lanes)];
+            m.score = scoreQuiet<Me>(m.move);
+        }
+    }
+#endif
+
+    for (; current != end; current++) {
+        current->score = scoreQuiet<Me>(current->move);
+    }
+}
+
 template<Side Me>
 MoveScore MovePicker::scoreQuiet(Move m) {
     assert(movePromotionType(m) != QUEEN);
@@ -228,33 +440,8 @@ MoveScore MovePicker::scoreQuiet(Move m) {
     if (moveHistory != nullptr) [[likely]]
         score += moveHistory->getHistory<Me>(m);
 
-    // TODO: refactor this!
-    switch (pt) {
-        case PAWN:
-            if (pawnAttacks<Me>(bb(to)) & pos->getPiecesBB(~Me, KING)) {
-                score += 10000;
-            }
-            break;
-        case KNIGHT:
-            if (attacks<KNIGHT>(to, pos->getPiecesBB()) & pos->getPiecesBB(~Me, KING)) {
-                score += 10000;
-            }
-            break;
-        case BISHOP:
-            if (attacks<BISHOP>(to, pos->getPiecesBB()) & pos->getPiecesBB(~Me, KING)) {
-                score += 10000;
-            }
-        case ROOK:
-            if (attacks<ROOK>(to, pos->getPiecesBB()) & pos->getPiecesBB(~Me, KING)) {
-                score += 10000;
-            }
-        case QUEEN:
-            if (attacks<QUEEN>(to, pos->getPiecesBB()) & pos->getPiecesBB(~Me, KING)) {
-                score += 10000;
-            }
-        default:
-            break;
-    }
+    if (pos->givesCheck<Me>(m))
+        score += 10000;
 
     return score;
 }
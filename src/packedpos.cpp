@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include "packedpos.h"
+#include "uci.h"
+#include "utils.h"
+
+namespace Belette {
+
+PackedPosition packPosition(const Position &pos, Score whiteScore, GameResult result) {
+    PackedPosition packed;
+    std::memset(&packed, 0, sizeof(packed));
+
+    packed.occupancy = pos.getPiecesBB();
+
+    int i = 0;
+    Bitboard bb = packed.occupancy;
+    bitscan_loop(bb) {
+        Square sq = bitscan(bb);
+        packed.pieces[i / 2] |= uint8_t(pos.getPieceAt(sq)) << (4 * (i % 2));
+        i++;
+    }
+
+    packed.score = int16_t(std::clamp<int>(whiteScore, INT16_MIN, INT16_MAX));
+    setPackedResult(packed, result);
+    packed.sideAndEp = uint8_t((int(pos.getSideToMove()) << 7) | int(pos.getEpSquare()));
+    packed.castlingRights = uint8_t(pos.getCastlingRights());
+    packed.fiftyMoveRule = uint8_t(std::min(pos.getFiftyMoveRule(), 255));
+    packed.fullMoves = uint16_t(std::min(pos.getFullMoves(), 65535));
+
+    return packed;
+}
+
+std::string unpackFen(const PackedPosition &packed) {
+    Piece board[NB_SQUARE] = {};
+
+    int i = 0;
+    Bitboard bb = packed.occupancy;
+    bitscan_loop(bb) {
+        Square sq = bitscan(bb);
+        board[sq] = Piece((packed.pieces[i / 2] >> (4 * (i % 2))) & 0xF);
+        i++;
+    }
+
+    std::ostringstream ss;
+
+    for (int r = RANK_8; r >= RANK_1; --r) {
+        int nbEmpty = 0;
+
+        for (int f = FILE_A; f <= FILE_H; ++f) {
+            Piece p = board[square(File(f), Rank(r))];
+
+            if (p == NO_PIECE) {
+                nbEmpty++;
+                continue;
+            }
+
+            if (nbEmpty) ss << nbEmpty;
+            nbEmpty = 0;
+            ss << pieceToChar(p);
+        }
+
+        if (nbEmpty) ss << nbEmpty;
+        if (r > RANK_1) ss << '/';
+    }
+
+    Square epSquare = Square(packed.sideAndEp & 0x7F);
+
+    ss << ((packed.sideAndEp >> 7) == WHITE ? " w " : " b ");
+
+    if (packed.castlingRights & WHITE_KING_SIDE) ss << 'K';
+    if (packed.castlingRights & WHITE_QUEEN_SIDE) ss << 'Q';
+    if (packed.castlingRights & BLACK_KING_SIDE) ss << 'k';
+    if (packed.castlingRights & BLACK_QUEEN_SIDE) ss << 'q';
+    if (!(packed.castlingRights & ANY_CASTLING)) ss << '-';
+
+    ss << (epSquare == SQ_NONE ? " - " : " " + Uci::formatSquare(epSquare) + " ");
+    ss << int(packed.fiftyMoveRule) << " " << packed.fullMoves;
+
+    return ss.str();
+}
+
+std::string formatPackedPosition(const PackedPosition &packed) {
+    std::ostringstream ss;
+    ss << unpackFen(packed) << " | " << packed.score << " | " << formatPackedResult(packed);
+
+    return ss.str();
+}
+
+bool parsePackedPosition(const std::string &line, PackedPosition &packed) {
+    size_t sep1 = line.find('|');
+    size_t sep2 = sep1 == std::string::npos ? sep1 : line.find('|', sep1 + 1);
+    if (sep2 == std::string::npos) return false;
+
+    Position pos;
+    if (!pos.setFromFEN(line.substr(0, sep1))) return false;
+
+    std::string result = line.substr(sep2 + 1);
+    result.erase(0, result.find_first_not_of(" \t"));
+
+    GameResult gameResult = result.starts_with("1.0") || result.starts_with("1-0") ? RESULT_WHITE_WIN
+                          : result.starts_with("0.0") || result.starts_with("0-1") ? RESULT_BLACK_WIN
+                          : RESULT_DRAW;
+
+    packed = packPosition(pos, Score(parseInt(line.substr(sep1 + 1, sep2 - sep1 - 1))), gameResult);
+
+    return true;
+}
+
+int64_t convertPackedFile(const std::string &input, const std::string &output, bool toText) {
+    std::ifstream in(input, toText ? std::ios::binary : std::ios::in);
+    std::ofstream out(output, toText ? std::ios::out : std::ios::binary);
+    if (!in.is_open() || !out.is_open()) return -1;
+
+    int64_t count = 0;
+    PackedPosition packed;
+
+    if (toText) {
+        while (in.read(reinterpret_cast<char *>(&packed), sizeof(packed))) {
+            out << formatPackedPosition(packed) << '\n';
+            count++;
+        }
+    } else {
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!parsePackedPosition(line, packed)) continue;
+
+            out.write(reinterpret_cast<const char *>(&packed), sizeof(packed));
+            count++;
+        }
+    }
+
+    return count;
+}
+
+} /* namespace Belette */
@@ -0,0 +1,45 @@
+#ifndef PACKEDPOS_H_INCLUDED
+#define PACKEDPOS_H_INCLUDED
+
+#include <string>
+#include "chess.h"
+#include "position.h"
+#include "game.h"
+
+namespace Belette {
+
+// Compact position record used for training data (32 bytes)
+struct PackedPosition {
+    uint64_t occupancy;     // Occupied squares
+    uint8_t pieces[16];     // One nibble per occupied square, in square order (low nibble first)
+    int16_t score;          // Search score from white point of view
+    uint8_t result;         // 0 = black win, 1 = draw, 2 = white win
+    uint8_t sideAndEp;      // Bit 7 = side to move, bits 0-6 = en passant square (SQ_NONE if none)
+    uint8_t castlingRights;
+    uint8_t fiftyMoveRule;
+    uint16_t fullMoves;
+};
+
+static_assert(sizeof(PackedPosition) == 32);
+
+PackedPosition packPosition(const Position &pos, Score whiteScore, GameResult result = RESULT_DRAW);
+std::string unpackFen(const PackedPosition &packed);
+
+inline void setPackedResult(PackedPosition &packed, GameResult result) {
+    packed.result = result == RESULT_WHITE_WIN ? 2 : result == RESULT_BLACK_WIN ? 0 : 1;
+}
+
+inline const char* formatPackedResult(const PackedPosition &packed) {
+    return packed.result == 2 ? "1.0" : packed.result == 0 ? "0.0" : "0.5";
+}
+
+// Text format is one position per line: "<fen> | <white score> | <result 1.0/0.5/0.0>"
+std::string formatPackedPosition(const PackedPosition &packed);
+bool parsePackedPosition(const std::string &line, PackedPosition &packed);
+
+// Convert a binary file to text (or text to binary), returns the number of positions converted or -1 on error
+int64_t convertPackedFile(const std::string &input, const std::string &output, bool toText);
+
+} /* namespace Belette */
+
+#endif /* PACKEDPOS_H_INCLUDED */
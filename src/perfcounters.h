@@ -0,0 +1,44 @@
+#ifndef PERFCOUNTERS_H_INCLUDED
+#define PERFCOUNTERS_H_INCLUDED
+
+#include <cstdint>
+
+namespace Belette {
+
+enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    NB_PERF_EVENT
+};
+
+// Hardware performance counters of the calling thread (Linux perf_event_open), unavailable elsewhere
+class PerfCounters {
+public:
+    PerfCounters();
+    PerfCounters(const PerfCounters &) = delete;
+    ~PerfCounters();
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    static const char* name(PerfEvent event);
+
+    inline bool isAvailable(PerfEvent event) const { return fds[event] >= 0; }
+    bool isAvailable() const;
+
+    void start();
+    void stop();
+
+    // Value counted between start() and stop(), scaled if the counter was multiplexed
+    inline uint64_t value(PerfEvent event) const { return values[event]; }
+
+private:
+    int fds[NB_PERF_EVENT];
+    uint64_t values[NB_PERF_EVENT] = {};
+};
+
+} /* namespace Belette */
+
+#endif /* PERFCOUNTERS_H_INCLUDED */
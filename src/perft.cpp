@@ -1,4 +1,5 @@
 #include <iostream>
+#include <memory>
 #include "perft.h"
 #include "movegen.h"
 #include "uci.h"
@@ -11,12 +12,12 @@ namespace Belette {
  * Perft using the MovePicker (slower)
  */
 template<bool Div, Side Me>
-size_t perftmp(Position &pos, int depth) {
+size_t perftmp(Position &pos, int depth, MoveArena &arena) {
     size_t total = 0;
     MoveList moves;
     
     if (!Div && depth <= 1) {
-        MovePicker mp(pos);
+        MovePicker mp(pos, arena);
         mp.enumerate<MAIN, Me>([&](Move m, bool& skipQuiets) {
             total += 1;
             return true;
@@ -25,7 +26,7 @@ size_t perftmp(Position &pos, int depth) {
         return total;
     }
     
-    MovePicker mp(pos);
+    MovePicker mp(pos, arena);
     mp.enumerate<MAIN, Me>([&](Move move, bool& skipQuiets) {
         size_t n = 0;
 
@@ -33,7 +34,7 @@ size_t perftmp(Position &pos, int depth) {
             n = 1;
         } else {
             pos.doMove<Me>(move);
-            n = (depth == 1 ? 1 : perftmp<false, ~Me>(pos, depth - 1));
+            n = (depth == 1 ? 1 : perftmp<false, ~Me>(pos, depth - 1, arena));
             pos.undoMove<Me>(move);
         }
 
@@ -48,14 +49,15 @@ size_t perftmp(Position &pos, int depth) {
     return total;
 }
 
-template size_t perftmp<true, WHITE>(Position &pos, int depth);
-template size_t perftmp<false, WHITE>(Position &pos, int depth);
-template size_t perftmp<true, BLACK>(Position &pos, int depth);
-template size_t perftmp<false, BLACK>(Position &pos, int depth);
+template size_t perftmp<true, WHITE>(Position &pos, int depth, MoveArena &arena);
+template size_t perftmp<false, WHITE>(Position &pos, int depth, MoveArena &arena);
+template size_t perftmp<true, BLACK>(Position &pos, int depth, MoveArena &arena);
+template size_t perftmp<false, BLACK>(Position &pos, int depth, MoveArena &arena);
 
 template<bool Div>
 size_t perftmp(Position &pos, int depth) {
-    return pos.getSideToMove() == WHITE ? perftmp<Div, WHITE>(pos, depth) : perftmp<Div, BLACK>(pos, depth);
+    auto arena = std::make_unique<MoveArena>();
+    return pos.getSideToMove() == WHITE ? perftmp<Div, WHITE>(pos, depth, *arena) : perftmp<Div, BLACK>(pos, depth, *arena);
 }
 
 template size_t perftmp<true>(Position &pos, int depth);
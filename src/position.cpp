@@ -1,4 +1,5 @@
 #include <sstream>
+#include <algorithm>
 #include <cstring>
 #include "position.h"
 #include "uci.h"
@@ -84,7 +85,7 @@ std::string Position::fen() const {
     if (canCastle(WHITE_KING_SIDE)) ss << 'K';
     if (canCastle(WHITE_QUEEN_SIDE)) ss << 'Q';
     if (canCastle(BLACK_KING_SIDE)) ss << 'k';
-    if (canCastle(BLACK_KING_SIDE)) ss << 'q';
+    if (canCastle(BLACK_QUEEN_SIDE)) ss << 'q';
     if (!canCastle(ANY_CASTLING)) ss << '-';
 
     ss << (getEpSquare() == SQ_NONE ? " - " : " " + Uci::formatSquare(getEpSquare()) + " ");
@@ -223,40 +224,6 @@ std::string Position::debugHistory() {
     return ss.str();
 }
 
-/*
-WIP:
-inline bool Position::givesCheck(Move m) {
-    Side Me = getSideToMove();
-    Side Opp = ~Me;
-    Square ksq = getKingSquare(Opp);
-
-    Bitboard bb[NB_PIECE_TYPE] = {
-        getPiecesBB(),
-        getPiecesBB(Me, PAWN),
-        getPiecesBB(Me, KNIGHT),
-        getPiecesBB(Me, BISHOP),
-        getPiecesBB(Me, ROOK),
-        getPiecesBB(Me, QUEEN)
-    };
-
-    switch(moveType(m)) {
-        case NORMAL:
-        case CASTLING:
-        case PROMOTION:
-        case EN_PASSANT:
-        break;
-    }
-
-    return ((pawnAttacks(Me, ksq) & bb[PAWN])
-        || (attacks<KNIGHT>(ksq) & bb[KNIGHT])
-        || (attacks<BISHOP>(ksq, bb[ALL_PIECES]) & (bb[BISHOP] | bb[QUEEN]))
-        || (attacks<ROOK>(ksq, bb[ALL_PIECES]) & (bb[ROOK] | bb[QUEEN]))
-    );
-}
-
-
-*/
-
 template<Side Me>
 bool Position::isLegal(Move move) const {
     if (!isValidMove(move)) return false;
@@ -566,6 +533,7 @@ template<Side Me> void Position::doNullMove() {
     updateThreatenedSquares<~Me>();
     state->checkers = EmptyBB; // Null move cannot gives check
     updatePinsAndCheckMask<~Me, false>();
+    updateCheckSquares<~Me>();
 }
 
 template void Position::doNullMove<WHITE>();
@@ -588,6 +556,7 @@ inline void Position::updateBitboards() {
     updateThreatenedSquares<Me>();
     updateCheckers<Me>();
     checkers() ? updatePinsAndCheckMask<Me, true>() : updatePinsAndCheckMask<Me, false>();
+    updateCheckSquares<Me>();
 }
 
 template<Side Me>
@@ -673,6 +642,28 @@ inline void Position::updatePinsAndCheckMask() {
     if constexpr (InCheck) state->checkMask = cm;
 }
 
+template<Side Me>
+inline void Position::updateCheckSquares() {
+    constexpr Side Opp = ~Me;
+    Square ksq = getKingSquare(Opp);
+
+    state->checkSquares[PAWN] = pawnAttacks(Opp, ksq);
+    state->checkSquares[KNIGHT] = attacks<KNIGHT>(ksq);
+    state->checkSquares[BISHOP] = attacks<BISHOP>(ksq, getPiecesBB());
+    state->checkSquares[ROOK] = attacks<ROOK>(ksq, getPiecesBB());
+    state->checkSquares[QUEEN] = state->checkSquares[BISHOP] | state->checkSquares[ROOK];
+    state->checkSquares[KING] = EmptyBB;
+
+    Bitboard d = EmptyBB;
+    Bitboard snipers = (attacks<BISHOP>(ksq) & getPiecesBB(Me, BISHOP, QUEEN)) | (attacks<ROOK>(ksq) & getPiecesBB(Me, ROOK, QUEEN));
+    bitscan_loop(snipers) {
+        Bitboard b = betweenBB(ksq, bitscan(snipers)) & getPiecesBB();
+        if (popcount(b) == 1) d |= b & getPiecesBB(Me);
+    }
+
+    state->discoverers = d;
+}
+
 template<Side Me>
 inline void Position::updateCheckers() {
     Square ksq = getKingSquare(Me);
@@ -702,7 +693,71 @@ uint64_t Position::computeHash() const {
     return h;
 }
 
-// Static exchange evaluation. Algorithm from stockfish
+uint64_t Position::polyglotHash() const {
+    uint64_t h = 0;
+
+    Bitboard pieces = getPiecesBB();
+    bitscan_loop(pieces) {
+        Square sq = bitscan(pieces);
+        Piece p = getPieceAt(sq);
+        int kind = 2 * (pieceType(p) - 1) + (side(p) == WHITE);
+
+        h ^= Zobrist::polyglotKeys[64 * kind + sq];
+    }
+
+    constexpr CastlingRight castlings[] = { WHITE_KING_SIDE, WHITE_QUEEN_SIDE, BLACK_KING_SIDE, BLACK_QUEEN_SIDE };
+    for (int i = 0; i < 4; i++) {
+        if (canCastle(castlings[i])) h ^= Zobrist::polyglotKeys[Zobrist::POLYGLOT_CASTLING_OFFSET + i];
+    }
+
+    // En passant only counts if a pawn can actually capture
+    Square ep = getEpSquare();
+    if (ep != SQ_NONE && (pawnAttacks(~getSideToMove(), ep) & getPiecesBB(getSideToMove(), PAWN)))
+        h ^= Zobrist::polyglotKeys[Zobrist::POLYGLOT_ENPASSANT_OFFSET + fileOf(ep)];
+
+    if (getSideToMove() == WHITE) h ^= Zobrist::polyglotKeys[Zobrist::POLYGLOT_TURN_OFFSET];
+
+    return h;
+}
+
+// Pieces of the given side which cannot take part in an exchange on "to" because they are pinned
+// on another line. Pins of the side to move are already known, the other side has to compute them
+// (a pinner which already left its square with the first capture does not count)
+Bitboard Position::seePinned(Side side, Square to, Bitboard occupied) const {
+    if (side == getSideToMove()) {
+        Bitboard pins = (pinDiag() & -Bitboard(!(pinDiag() & to))) | (pinOrtho() & -Bitboard(!(pinOrtho() & to)));
+        return pins & getPiecesBB(side);
+    }
+
+    Square ksq = getKingSquare(side);
+    Bitboard pinned = EmptyBB;
+    Bitboard pinners = (attacks<BISHOP>(ksq, getPiecesBB(~side)) & getPiecesBB(~side, BISHOP, QUEEN))
+                     | (attacks<ROOK>(ksq, getPiecesBB(~side)) & getPiecesBB(~side, ROOK, QUEEN));
+    pinners &= occupied;
+
+    bitscan_loop(pinners) {
+        Square s = bitscan(pinners);
+        Bitboard line = betweenBB(ksq, s) | s;
+        Bitboard blockers = line & getPiecesBB(side);
+
+        pinned |= blockers & -Bitboard(popcount(blockers) == 1 && !(line & to));
+    }
+
+    return pinned;
+}
+
+// Least valuable attacker of the given side, its square is returned in "from"
+inline PieceType Position::seeNextAttacker(Bitboard attackers, Square &from) const {
+    PieceType pt = PAWN;
+    Bitboard b;
+
+    while (!(b = attackers & getPiecesTypeBB(pt))) pt = PieceType(pt + 1);
+    from = bitscan(b);
+
+    return pt;
+}
+
+// Static exchange evaluation, returns true if the exchange on the destination square wins at least "threshold". Algorithm from stockfish
 bool Position::see(Move move, int threshold) const {
     assert(isValidMove(move));
     assert(getSideToMove() == side(getPieceAt(moveFrom(move))));
@@ -717,60 +772,83 @@ bool Position::see(Move move, int threshold) const {
     if (value <= 0) return true;
 
     Bitboard occupied = getPiecesBB() ^ from ^ to;
-    Side me = ~getSideToMove();
+    Bitboard diagSliders = getPiecesTypeBB(BISHOP, QUEEN), orthoSliders = getPiecesTypeBB(ROOK, QUEEN);
     Bitboard allAttackers = getAttackers(to, occupied) & occupied;
+    Bitboard pinned = seePinned(WHITE, to, occupied) | seePinned(BLACK, to, occupied);
+    Side me = ~getSideToMove();
     int result = 1;
 
     while (true) {
-        Bitboard myAttackers = allAttackers & getPiecesBB(me);
+        Bitboard myAttackers = allAttackers & getPiecesBB(me) & ~pinned;
         if (!myAttackers) break; // No more attackers
 
-        // TODO: remove pinned pieces
-
         result ^= 1;
 
-        Bitboard nextAttacker;
-
-        if ((nextAttacker = myAttackers & getPiecesTypeBB(PAWN))) { // Pawn
-            value = PieceValue<MG>(PAWN) - value;
-            if (value < result) break;
-
-            occupied ^= bitscan(nextAttacker);
-            allAttackers |= attacks<BISHOP>(to, occupied) & getPiecesTypeBB(BISHOP, QUEEN); // Add X-Ray attackers
-        } else if ((nextAttacker = myAttackers & getPiecesTypeBB(KNIGHT))) { // Knight
-            value = PieceValue<MG>(KNIGHT) - value;
-            if (value < result) break;
-
-            occupied ^= bitscan(nextAttacker);
-        } else if ((nextAttacker = myAttackers & getPiecesTypeBB(BISHOP))) { // Bishop
-            value = PieceValue<MG>(BISHOP) - value;
-            if (value < result) break;
-
-            occupied ^= bitscan(nextAttacker);
-            allAttackers |= attacks<BISHOP>(to, occupied) & getPiecesTypeBB(BISHOP, QUEEN); // Add X-Ray attackers
-        } else if ((nextAttacker = myAttackers & getPiecesTypeBB(ROOK))) { // Rook
-            value = PieceValue<MG>(ROOK) - value;
-            if (value < result) break;
-
-            occupied ^= bitscan(nextAttacker);
-            allAttackers |= attacks<ROOK>(to, occupied) & getPiecesTypeBB(ROOK, QUEEN); // Add X-Ray attackers
-        } else if ((nextAttacker = myAttackers & getPiecesTypeBB(QUEEN))) { // Queen
-            value = PieceValue<MG>(QUEEN) - value;
-            if (value < result) break;
-
-            occupied ^= bitscan(nextAttacker);
-            allAttackers |= (attacks<BISHOP>(to, occupied) & getPiecesTypeBB(BISHOP, QUEEN)) // Add X-Ray attackers
-                         |  (attacks<ROOK>(to, occupied) & getPiecesTypeBB(ROOK, QUEEN));
-        } else { // King
-            // King cannot capture if opponent still has attackers
-            return (allAttackers & ~getPiecesBB(me)) ? result ^ 1 : result;
-        }
+        Square sq;
+        PieceType pt = seeNextAttacker(myAttackers, sq);
 
-        me = ~me;
+        // King cannot capture if opponent still has attackers
+        if (pt == KING)
+            return (allAttackers & getPiecesBB(~me) & ~pinned) ? result ^ 1 : result;
+
+        value = PieceValue<MG>(pt) - value;
+        if (value < result) break;
+
+        occupied ^= sq;
+        allAttackers |= (attacks<BISHOP>(to, occupied) & diagSliders) | (attacks<ROOK>(to, occupied) & orthoSliders); // Add X-Ray attackers
         allAttackers &= occupied;
+        me = ~me;
     }
 
     return (bool)result;
 }
 
+// Static exchange evaluation, exact material balance of the exchange using a swap list
+Score Position::seeValue(Move move) const {
+    assert(isValidMove(move));
+    assert(getSideToMove() == side(getPieceAt(moveFrom(move))));
+
+    Square from = moveFrom(move);
+    Square to = moveTo(move);
+
+    Score gain[32];
+    int d = 0;
+    gain[0] = PieceValue<MG>(getPieceAt(to));
+
+    Bitboard occupied = getPiecesBB() ^ from ^ to;
+    Bitboard diagSliders = getPiecesTypeBB(BISHOP, QUEEN), orthoSliders = getPiecesTypeBB(ROOK, QUEEN);
+    Bitboard allAttackers = getAttackers(to, occupied) & occupied;
+    Bitboard pinned = seePinned(WHITE, to, occupied) | seePinned(BLACK, to, occupied);
+    PieceType captured = pieceType(getPieceAt(from));
+    Side me = ~getSideToMove();
+
+    while (true) {
+        Bitboard myAttackers = allAttackers & getPiecesBB(me) & ~pinned;
+        if (!myAttackers) break; // No more attackers
+
+        Square sq;
+        PieceType pt = seeNextAttacker(myAttackers, sq);
+
+        // King cannot capture if opponent still has attackers
+        if (pt == KING && (allAttackers & getPiecesBB(~me) & ~pinned)) break;
+
+        d++;
+        gain[d] = PieceValue<MG>(captured) - gain[d-1];
+        captured = pt;
+
+        occupied ^= sq;
+        allAttackers |= (attacks<BISHOP>(to, occupied) & diagSliders) | (attacks<ROOK>(to, occupied) & orthoSliders); // Add X-Ray attackers
+        allAttackers &= occupied;
+        me = ~me;
+    }
+
+    // Each side can stop the exchange when capturing is not profitable
+    while (d > 0) {
+        gain[d-1] = std::min(gain[d-1], Score(-gain[d]));
+        d--;
+    }
+
+    return gain[0];
+}
+
 } /* namespace Belette */
\ No newline at end of file
@@ -28,6 +28,8 @@ struct State {
     Bitboard checkMask;
     Bitboard pinDiag;
     Bitboard pinOrtho;
+    Bitboard checkSquares[NB_PIECE_TYPE]; // Squares from where each of our piece types would check the opponent king
+    Bitboard discoverers; // Our pieces alone between one of our sliders and the opponent king
 
     inline State& prev() { return *(this-1); }
     inline const State& prev() const { return *(this-1); }
@@ -49,13 +51,14 @@ public:
     inline void doMove(Move m) { getSideToMove() == WHITE ? doMove<WHITE>(m) : doMove<BLACK>(m); }
     template<Side Me> inline void doMove(Move m);
 
-    inline void undoMove(Move m) { getSideToMove() == WHITE ? undoMove<WHITE>(m) : undoMove<BLACK>(m); }
+    inline void undoMove(Move m) { getSideToMove() == WHITE ? undoMove<BLACK>(m) : undoMove<WHITE>(m); }
     template<Side Me> inline void undoMove(Move m);
 
     template<Side Me> void doNullMove();
     template<Side Me> void undoNullMove();
 
-    //bool givesCheck(Move m);
+    template<Side Me> inline bool givesCheck(Move m) const;
+    inline bool givesCheck(Move m) const { return getSideToMove() == WHITE ? givesCheck<WHITE>(m) : givesCheck<BLACK>(m); }
 
     inline Side getSideToMove() const { return sideToMove; }
     inline int getFiftyMoveRule() const { return state->fiftyMoveRule; }
@@ -63,6 +66,7 @@ public:
     inline int getFullMoves() const { return 1 + (getHalfMoves() - (sideToMove == BLACK)) / 2; }
     inline Square getEpSquare() const { return state->epSquare; }
     inline Piece getPieceAt(Square sq) const { return pieces[sq]; }
+    inline const Piece *getPieces() const { return pieces; }
     inline bool isEmpty(Square sq) const { return getPieceAt(sq) == NO_PIECE; }
     inline bool isEmpty(Bitboard b) const { return !(b & getPiecesBB()); }
     inline bool canCastle(CastlingRight cr) const { return state->castlingRights & cr; }
@@ -98,6 +102,7 @@ public:
     inline Bitboard getAttackers(Square sq, Bitboard occupied) const;
 
     inline Bitboard threatsFor(PieceType pt) const { return state->threatsFor[pt]; }
+    inline const Bitboard *threatsTable() const { return state->threatsFor; }
     inline Bitboard checkedSquares() const { return threatsFor(KING); }
     inline Bitboard checkers() const { return state->checkers; }
     inline Bitboard nbCheckers() const { return popcount(state->checkers); }
@@ -105,12 +110,15 @@ public:
 
     inline uint64_t hash() const { return state->hash; }
     uint64_t computeHash() const;
+    uint64_t polyglotHash() const; // Key of the position in Polyglot opening books
     inline uint64_t getHashAfter(Move m) const;
     inline uint64_t getHashAfterNullMove() const { return hash() ^ Zobrist::sideToMoveKey; };
 
     inline Bitboard checkMask() const { return state->checkMask; }
     inline Bitboard pinDiag() const { return state->pinDiag; }
     inline Bitboard pinOrtho() const { return state->pinOrtho; }
+    inline Bitboard checkSquares(PieceType pt) const { return state->checkSquares[pt]; }
+    inline Bitboard discoverers() const { return state->discoverers; }
 
     inline size_t historySize() const { return state - history; }
 
@@ -128,13 +136,17 @@ public:
 
     inline Move previousMove() const { return state->move; }
     
-    bool see(Move m, int threshold) const ;
+    bool see(Move m, int threshold) const;
+    Score seeValue(Move m) const;
 
     std::string debugHistory();
 
 private:
     void setCastlingRights(CastlingRight cr);
 
+    Bitboard seePinned(Side side, Square to, Bitboard occupied) const;
+    inline PieceType seeNextAttacker(Bitboard attackers, Square &from) const;
+
     template<Side Me, MoveType Mt> void doMove(Move m);
     template<Side Me, MoveType Mt> void undoMove(Move m);
 
@@ -147,6 +159,7 @@ private:
     template<Side Me> inline void updateThreatenedSquares();
     template<Side Me> inline void updateCheckers();
     template<Side Me, bool InCheck> inline void updatePinsAndCheckMask();
+    template<Side Me> inline void updateCheckSquares();
 
     inline void updateBitboards();
     template<Side Me> inline void updateBitboards();
@@ -162,6 +175,9 @@ private:
     State history[MAX_HISTORY];
 };
 
+char pieceToChar(Piece p);
+Piece charToPiece(char c);
+
 std::ostream& operator<<(std::ostream& os, const Position& pos);
 
 inline Bitboard Position::getAttackers(Square sq, Bitboard occupied) const {
@@ -238,6 +254,50 @@ inline void Position::undoMove(Move m) {
     }
 }
 
+// Uses the check squares and discoverers of the State, special moves are checked against the position after the move
+template<Side Me>
+inline bool Position::givesCheck(Move m) const {
+    const Square from = moveFrom(m), to = moveTo(m);
+    const Square ksq = getKingSquare(~Me);
+
+    assert(side(getPieceAt(from)) == Me);
+
+    // Direct check
+    if (state->checkSquares[pieceType(getPieceAt(from))] & bb(to))
+        return true;
+
+    // Discovered check, unless the piece stays on the line to the king
+    if ((state->discoverers & bb(from)) && !(betweenBB(ksq, from) & bb(to)) && !(betweenBB(ksq, to) & bb(from)))
+        return true;
+
+    switch(moveType(m)) {
+        case NORMAL:
+            return false;
+        case PROMOTION: {
+            Bitboard occupied = getPiecesBB() ^ bb(from);
+            switch(movePromotionType(m)) {
+                case KNIGHT: return attacks<KNIGHT>(to) & bb(ksq);
+                case BISHOP: return attacks<BISHOP>(to, occupied) & bb(ksq);
+                case ROOK:   return attacks<ROOK>(to, occupied) & bb(ksq);
+                default:     return attacks<QUEEN>(to, occupied) & bb(ksq);
+            }
+        }
+        case EN_PASSANT: {
+            // The captured pawn may uncover a slider
+            Bitboard occupied = (getPiecesBB() ^ bb(from) ^ bb(to - pawnDirection(Me))) | bb(to);
+            return (attacks<BISHOP>(ksq, occupied) & getPiecesBB(Me, BISHOP, QUEEN))
+                || (attacks<ROOK>(ksq, occupied) & getPiecesBB(Me, ROOK, QUEEN));
+        }
+        case CASTLING: {
+            CastlingRight cr = Me & (to > from ? KING_SIDE : QUEEN_SIDE);
+            Bitboard occupied = (getPiecesBB() ^ bb(from) ^ bb(CastlingRookFrom[cr])) | bb(to) | bb(CastlingRookTo[cr]);
+            return attacks<ROOK>(CastlingRookTo[cr], occupied) & bb(ksq);
+        }
+    }
+
+    return false;
+}
+
 inline uint64_t Position::getHashAfter(Move m) const {
     uint64_t h = hash();
     const Square from = moveFrom(m), to = moveTo(m);
@@ -0,0 +1,218 @@
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <iomanip>
+#include "selfplay.h"
+#include "engine.h"
+#include "game.h"
+#include "epd.h"
+#include "uci.h"
+
+namespace Belette {
+
+class SelfPlayEngine : public Engine {
+public:
+    SelfPlayEngine(size_t hashSize): Engine(table), table(hashSize * 1024 * 1024) { }
+
+    Move bestMove = MOVE_NONE;
+    Score score = SCORE_NONE;
+
+private:
+    TranspositionTable table;
+
+    virtual void onSearchProgress(const SearchEvent &event) { }
+    virtual void onSearchFinish(const SearchEvent &event) {
+        bestMove = event.pv.empty() ? MOVE_NONE : event.pv.front();
+        score = event.bestScore;
+    }
+};
+
+struct MatchStats {
+    int wins = 0, losses = 0, draws = 0; // Engine A point of view
+
+    inline int nbGames() const { return wins + losses + draws; }
+    inline double score() const { return (wins + 0.5 * draws) / nbGames(); }
+
+    // Variance of a single game result
+    inline double variance() const {
+        double s = score();
+        return (wins * (1.0 - s) * (1.0 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / nbGames();
+    }
+
+    static inline double elo(double score) { return -400.0 * std::log10(1.0 / score - 1.0); }
+    static inline double expectedScore(double elo) { return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0)); }
+
+    inline double elo() const { return elo(std::clamp(score(), 1e-6, 1.0 - 1e-6)); }
+
+    // 95% confidence interval
+    inline double eloError() const {
+        double margin = 1.959964 * std::sqrt(variance() / nbGames());
+        double low = std::clamp(score() - margin, 1e-6, 1.0 - 1e-6);
+        double high = std::clamp(score() + margin, 1e-6, 1.0 - 1e-6);
+        return (elo(high) - elo(low)) / 2.0;
+    }
+
+    // Log-likelihood ratio of the SPRT (normal approximation of the trinomial model)
+    inline double llr(double elo0, double elo1) const {
+        double var = variance();
+        if (nbGames() == 0 || var <= 0.0) return 0.0;
+
+        double s0 = expectedScore(elo0), s1 = expectedScore(elo1);
+        return (s1 - s0) * (2.0 * score() - s0 - s1) / (2.0 * var / nbGames());
+    }
+};
+
+void report(const MatchStats &stats, const SelfPlayParams &params, bool useSprt) {
+    console << "Games: " << stats.nbGames()
+            << " W: " << stats.wins << " L: " << stats.losses << " D: " << stats.draws
+            << std::fixed << std::setprecision(3) << " [" << stats.score() << "]"
+            << std::setprecision(1) << " Elo: " << stats.elo() << " +/- " << stats.eloError();
+
+    if (useSprt) {
+        console << std::setprecision(2) << " LLR: " << stats.llr(params.elo0, params.elo1)
+                << " (" << std::log(params.beta / (1.0 - params.alpha)) << ", " << std::log((1.0 - params.beta) / params.alpha) << ")"
+                << " [" << params.elo0 << ", " << params.elo1 << "]";
+    }
+
+    console << std::endl;
+}
+
+// Play a single game, returns the result from white point of view
+GameResult playGame(const Position &opening, SelfPlayEngine *engines[NB_SIDE], const SelfPlayEngineConfig *configs[NB_SIDE], const SelfPlayParams &params) {
+    Position pos = opening;
+    TimeMs clock[NB_SIDE] = { configs[WHITE]->time, configs[BLACK]->time };
+    int winCount[NB_SIDE] = {0}, drawCount = 0;
+
+    for (int ply = 0; ply < params.maxPlies; ply++) {
+        GameResult result = getGameResult(pos);
+        if (result != RESULT_NONE) return result;
+
+        Side stm = pos.getSideToMove();
+        SelfPlayEngine &engine = *engines[stm];
+        const SelfPlayEngineConfig &config = *configs[stm];
+
+        SearchLimits limits;
+        limits.maxDepth = config.depth;
+        limits.maxNodes = config.nodes;
+        if (config.time > 0) {
+            for (Side side : {WHITE, BLACK}) {
+                limits.timeLeft[side] = std::max<TimeMs>(1, clock[side]);
+                limits.increment[side] = configs[side]->increment;
+            }
+        }
+
+        engine.position() = pos;
+
+        TimeMs start = now();
+        engine.searchSync(limits);
+        TimeMs elapsed = now() - start;
+
+        if (config.time > 0) {
+            clock[stm] -= elapsed;
+            if (clock[stm] < 0) return stm == WHITE ? RESULT_BLACK_WIN : RESULT_WHITE_WIN; // Lost on time
+            clock[stm] += config.increment;
+        }
+
+        if (!pos.isLegal(engine.bestMove)) {
+            return stm == WHITE ? RESULT_BLACK_WIN : RESULT_WHITE_WIN;
+        }
+
+        // Adjudication, score from white point of view
+        if (params.adjudicate && engine.score != SCORE_NONE) {
+            Score score = stm == WHITE ? engine.score : -engine.score;
+
+            winCount[WHITE] = score >= params.resignScore ? winCount[WHITE] + 1 : 0;
+            winCount[BLACK] = score <= -params.resignScore ? winCount[BLACK] + 1 : 0;
+            if (winCount[WHITE] >= 2 * params.resignMoves) return RESULT_WHITE_WIN;
+            if (winCount[BLACK] >= 2 * params.resignMoves) return RESULT_BLACK_WIN;
+
+            drawCount = pos.getFullMoves() >= params.drawMinMove && std::abs(score) <= params.drawScore ? drawCount + 1 : 0;
+            if (drawCount >= 2 * params.drawMoves)
+                return RESULT_DRAW;
+        }
+
+        pos.doMove(engine.bestMove);
+    }
+
+    return RESULT_DRAW;
+}
+
+void selfplay(const SelfPlayParams &params) {
+    std::vector<EpdEntry> openings;
+
+    if (!params.openings.empty() && (!loadEpdFile(params.openings, openings) || openings.empty())) {
+        console << "Unable to load openings from '" << params.openings << "'" << std::endl;
+        return;
+    }
+
+    bool useSprt = params.elo0 != params.elo1;
+    double lowerBound = std::log(params.beta / (1.0 - params.alpha));
+    double upperBound = std::log((1.0 - params.beta) / params.alpha);
+
+    MatchStats stats;
+    std::mutex statsMutex;
+    std::atomic<int> nextGame = 0;
+    std::atomic<bool> finished = false;
+
+    auto worker = [&]() {
+        SelfPlayEngine engineA(params.engines[0].hashSize), engineB(params.engines[1].hashSize);
+        Position opening;
+        int game;
+
+        while (!finished && (game = nextGame++) < params.nbGames) {
+            // Each opening is played twice, with colors reversed
+            int pair = game / 2;
+            bool aIsWhite = (game % 2 == 0);
+
+            if (!openings.empty()) {
+                if (!opening.setFromFEN(openings[pair % openings.size()].fen)) continue;
+            } else if (!randomOpening(opening, params.randomPlies, pair)) {
+                continue;
+            }
+
+            SelfPlayEngine *engines[NB_SIDE] = { aIsWhite ? &engineA : &engineB, aIsWhite ? &engineB : &engineA };
+            const SelfPlayEngineConfig *configs[NB_SIDE] = { 
+                &params.engines[aIsWhite ? 0 : 1], &params.engines[aIsWhite ? 1 : 0]
+            };
+
+            engineA.newGame();
+            engineB.newGame();
+
+            GameResult result = playGame(opening, engines, configs, params);
+
+            std::lock_guard<std::mutex> lock(statsMutex);
+
+            if (result == RESULT_DRAW) stats.draws++;
+            else if ((result == RESULT_WHITE_WIN) == aIsWhite) stats.wins++;
+            else stats.losses++;
+
+            report(stats, params, useSprt);
+
+            if (useSprt) {
+                double llr = stats.llr(params.elo0, params.elo1);
+                
+                if (!finished && (llr <= lowerBound || llr >= upperBound)) {
+                    finished = true;
+                    console << "SPRT: " << (llr >= upperBound ? "H1 accepted" : "H0 accepted") << std::endl;
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i=0; i<std::max(1, params.nbThreads); i++) {
+        threads.emplace_back(worker);
+    }
+
+    for (auto &th : threads) {
+        th.join();
+    }
+
+    console << std::endl << "-----------------------------" << std::endl;
+    if (stats.nbGames() > 0) report(stats, params, useSprt);
+}
+
+} /* namespace Belette */
@@ -0,0 +1,48 @@
+#ifndef SELFPLAY_H_INCLUDED
+#define SELFPLAY_H_INCLUDED
+
+#include <string>
+#include "chess.h"
+#include "utils.h"
+
+namespace Belette {
+
+constexpr size_t DEFAULT_SELFPLAY_NODES = 5000;
+
+struct SelfPlayEngineConfig {
+    size_t hashSize = 16; // In megabytes
+    int depth = 0;
+    size_t nodes = 0;
+    TimeMs time = 0; // Base time of the time control in ms
+    TimeMs increment = 0;
+};
+
+struct SelfPlayParams {
+    SelfPlayEngineConfig engines[2];
+    std::string openings; // EPD file, random openings are used if empty
+    int randomPlies = 8;
+    int nbGames = 100;
+    int nbThreads = 1;
+
+    // Adjudication
+    bool adjudicate = true;
+    Score resignScore = 1000;
+    int resignMoves = 3;
+    Score drawScore = 10;
+    int drawMoves = 8;
+    int drawMinMove = 34;
+    int maxPlies = 1000;
+
+    // SPRT, disabled if elo0 == elo1
+    double elo0 = 0.0;
+    double elo1 = 5.0;
+    double alpha = 0.05;
+    double beta = 0.05;
+};
+
+// Play games between two engine configurations (A and B) and report Elo and SPRT from A point of view
+void selfplay(const SelfPlayParams &params);
+
+} /* namespace Belette */
+
+#endif /* SELFPLAY_H_INCLUDED */
@@ -0,0 +1,369 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "server.h"
+#include "engine.h"
+#include "tt.h"
+#include "uci.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <csignal>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define SERVER_SOCKETS
+#endif
+
+namespace Belette {
+
+#ifdef SERVER_SOCKETS
+
+class Session;
+
+// Runs the bounded searches of all the sessions with a fixed number of threads, in the order they were requested.
+// A session has at most one search queued or running, so a client never waits for more than one search per other client.
+// Infinite and ponder searches only end on the client's stop, they run on a thread of their session instead
+class SearchPool {
+public:
+    SearchPool(int nbWorkers);
+    ~SearchPool();
+
+    void submit(Session *session);
+
+private:
+    std::mutex mutex;
+    std::condition_variable queueChanged;
+    std::deque<Session *> queue;
+    std::vector<std::thread> workers;
+    bool stopping = false;
+
+    void workerLoop();
+};
+
+// UCI session of a client, with its own position, move history and search state. The transposition table is shared
+class Session : public Engine {
+public:
+    Session(int fd_, SearchPool &pool_): Engine(Belette::tt), fd(fd_), pool(pool_) {
+        // The sessions search the shared table at the same time, none of them ages it
+        setHashAging(false);
+    }
+    ~Session() { ::close(fd); }
+
+    // Execute the commands of the client until it quits or disconnects
+    void run();
+
+    // Called by a worker of the pool, or by the search thread of the session for unbounded searches
+    void runSearch();
+
+private:
+    enum class State { Idle, Queued, Searching };
+
+    int fd;
+    SearchPool &pool;
+    std::mutex writeMutex;
+
+    std::mutex stateMutex;
+    std::condition_variable stateChanged;
+    State state = State::Idle;
+    SearchLimits limits;
+    std::thread searchThread;
+
+    // stop may arrive before the worker has started the search, it is applied at the next iteration
+    std::atomic<bool> stopRequested = false;
+
+    void send(const std::string &line);
+    bool execute(const std::string &line);
+    void waitIdle();
+    void stopSearch();
+
+    virtual void onSearchProgress(const SearchEvent &event);
+    virtual void onSearchFinish(const SearchEvent &event);
+};
+
+SearchPool::SearchPool(int nbWorkers) {
+    for (int i=0; i<nbWorkers; i++) {
+        workers.emplace_back(&SearchPool::workerLoop, this);
+    }
+}
+
+SearchPool::~SearchPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    queueChanged.notify_all();
+
+    for (auto &th : workers) {
+        th.join();
+    }
+}
+
+void SearchPool::submit(Session *session) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(session);
+    }
+
+    queueChanged.notify_one();
+}
+
+void SearchPool::workerLoop() {
+    while (true) {
+        Session *session;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queueChanged.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (stopping) return;
+
+            session = queue.front();
+            queue.pop_front();
+        }
+
+        session->runSearch();
+    }
+}
+
+void Session::run() {
+    std::string buffer;
+    char chunk[4096];
+    bool running = true;
+
+    while (running) {
+        ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) break;
+
+        buffer.append(chunk, size_t(n));
+
+        size_t eol;
+        while (running && (eol = buffer.find('\n')) != std::string::npos) {
+            std::string line = buffer.substr(0, eol);
+            buffer.erase(0, eol + 1);
+
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty()) running = execute(line);
+        }
+    }
+
+    // The session can't be destroyed while the pool still refers to it
+    stopSearch();
+    if (searchThread.joinable()) searchThread.join();
+}
+
+void Session::runSearch() {
+    SearchLimits searchLimits;
+
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        state = State::Searching;
+        searchLimits = limits;
+    }
+
+    // Stopped while waiting for a worker: a depth 1 search still gives a legal bestmove
+    if (stopRequested) {
+        searchLimits = SearchLimits();
+        searchLimits.maxDepth = 1;
+    }
+
+    searchSync(searchLimits);
+
+    // Notify under the lock: the session may be destroyed as soon as waitIdle() returns
+    std::lock_guard<std::mutex> lock(stateMutex);
+    state = State::Idle;
+    stateChanged.notify_all();
+}
+
+void Session::waitIdle() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    stateChanged.wait(lock, [&] { return state == State::Idle; });
+}
+
+// A client may send a command without stopping an infinite or ponder search first
+void Session::stopSearch() {
+    stopRequested = true;
+    stop();
+    waitIdle();
+}
+
+void Session::send(const std::string &line) {
+    std::lock_guard<std::mutex> lock(writeMutex);
+    std::string data = line + "\n";
+    size_t sent = 0;
+
+    while (sent < data.size()) {
+        ssize_t n = ::send(fd, data.data() + sent, data.size() - sent, 0);
+        if (n <= 0) return; // Disconnected, run() will end the session
+
+        sent += size_t(n);
+    }
+}
+
+bool Session::execute(const std::string &line) {
+    std::istringstream is(line);
+    std::string token;
+
+    is >> std::skipws >> token;
+
+    if (token == "uci") {
+        send("id name Belette " VERSION);
+        send("id author Vincent Bab");
+        send("");
+        send("option name Ponder type check default false");
+        send("uciok");
+    } else if (token == "isready") {
+        send("readyok");
+    } else if (token == "ucinewgame") {
+        // The transposition table is shared with the other sessions, only the history of this one is cleared
+        stopSearch();
+        clearHistory();
+    } else if (token == "setoption") {
+        std::string name;
+        is >> token >> name;
+        if (name == "Hash") send("info string Hash is shared by all the sessions, it is set when starting the server");
+    } else if (token == "position") {
+        stopSearch();
+        if (!Uci::parsePosition(is, position())) send("info string Invalid FEN position");
+    } else if (token == "go") {
+        stopSearch();
+        if (searchThread.joinable()) searchThread.join();
+
+        // Cleared before queuing the search, a ponderhit received while it is queued is kept
+        stopRequested = false;
+        clearPonderhit();
+
+        bool unbounded;
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            limits = Uci::parseSearchLimits(is, position());
+            unbounded = limits.infinite || limits.ponder;
+            state = State::Queued;
+        }
+
+        // An unbounded search would hold a worker until the client stops it
+        if (unbounded) searchThread = std::thread(&Session::runSearch, this);
+        else pool.submit(this);
+    } else if (token == "stop") {
+        stopRequested = true;
+        stop();
+    } else if (token == "ponderhit") {
+        ponderhit(); // Only flags the search, which applies it from its own thread
+    } else if (token == "quit") {
+        return false;
+    } else {
+        send("info string Unknow command '" + token + "'");
+    }
+
+    return true;
+}
+
+void Session::onSearchProgress(const SearchEvent &event) {
+    if (stopRequested) stop();
+
+    send(Uci::formatInfo(event));
+}
+
+void Session::onSearchFinish(const SearchEvent &event) {
+    send(Uci::formatBestMove(event));
+}
+
+static int listenTcp(int port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Only local clients
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(uint16_t(port));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || ::listen(fd, SOMAXCONN) < 0) {
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+static int listenUnix(const std::string &path) {
+    sockaddr_un addr = {};
+    if (path.size() >= sizeof(addr.sun_path)) return -1;
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    addr.sun_family = AF_UNIX;
+    path.copy(addr.sun_path, path.size());
+    ::unlink(path.c_str());
+
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || ::listen(fd, SOMAXCONN) < 0) {
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+void serve(const ServerParams &params) {
+    std::string address = params.unixPath.empty() ? "127.0.0.1:" + std::to_string(params.port) : params.unixPath;
+    int listenFd = params.unixPath.empty() ? listenTcp(params.port) : listenUnix(params.unixPath);
+
+    if (listenFd < 0) {
+        console << "Unable to listen on " << address << std::endl;
+        return;
+    }
+
+    // A client disconnecting during a search must not kill the server
+    std::signal(SIGPIPE, SIG_IGN);
+
+    size_t hashSize = std::max<size_t>(params.hashSize, 1); // A table without buckets can't be searched
+    tt.resize(hashSize * 1024 * 1024);
+
+    int nbWorkers = params.nbWorkers > 0 ? params.nbWorkers : std::max(1, int(std::thread::hardware_concurrency()));
+    SearchPool pool(nbWorkers);
+
+    console << "Listening on " << address << " with " << nbWorkers << " search workers and " << hashSize << "MB of shared hash" << std::endl;
+
+    std::atomic<int> nbSessions = 0;
+    int nextId = 1;
+
+    while (true) {
+        int fd = ::accept(listenFd, nullptr, nullptr);
+
+        if (fd < 0) {
+            if (errno != EINTR) std::this_thread::sleep_for(std::chrono::milliseconds(100)); // ie: out of file descriptors
+            continue;
+        }
+
+        int id = nextId++;
+        console << "Session " << id << " connected (" << ++nbSessions << " active)" << std::endl;
+
+        std::thread([fd, id, &pool, &nbSessions] {
+            auto session = std::make_unique<Session>(fd, pool);
+            session->run();
+
+            console << "Session " << id << " disconnected (" << --nbSessions << " active)" << std::endl;
+        }).detach();
+    }
+}
+
+#else
+
+void serve(const ServerParams &params) {
+    console << "The server is only available on Unix systems" << std::endl;
+}
+
+#endif
+
+} /* namespace Belette */
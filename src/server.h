@@ -0,0 +1,21 @@
+#ifndef SERVER_H_INCLUDED
+#define SERVER_H_INCLUDED
+
+#include <string>
+
+namespace Belette {
+
+struct ServerParams {
+    int port = 0; // TCP port on the loopback interface
+    std::string unixPath; // Unix socket, used instead of the port if given
+    int nbWorkers = 0; // Searches running at the same time, 0 for one per cpu
+    size_t hashSize = 256; // In megabytes, shared by all the sessions
+};
+
+// UCI server: every client connected to the socket gets its own UCI session (position, history, search state),
+// all sessions share the transposition table and a pool of search workers. Runs until the process is killed
+void serve(const ServerParams &params);
+
+} /* namespace Belette */
+
+#endif /* SERVER_H_INCLUDED */
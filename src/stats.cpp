@@ -0,0 +1,107 @@
+#include <iomanip>
+#include <sstream>
+#include "stats.h"
+#include "uci.h"
+
+namespace Belette {
+
+#ifdef STATS
+SearchStats searchStats;
+#endif
+
+static const char* NODE_TYPE_NAMES[NB_STATS_NODE_TYPE] = { "Root", "PV", "NonPV" };
+
+static std::string percent(uint64_t count, uint64_t total) {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1) << (total ? 100.0 * count / total : 0.0) << "%";
+    return ss.str();
+}
+
+void SearchStats::clear() {
+    for (auto &stat : nodes)
+        for (auto &nodeType : stat)
+            for (auto &counter : nodeType)
+                counter.store(0, std::memory_order_relaxed);
+
+    for (auto &counter : global) counter.store(0, std::memory_order_relaxed);
+    for (auto &counter : qsearchDepth) counter.store(0, std::memory_order_relaxed);
+}
+
+uint64_t SearchStats::total(NodeStat stat, int nodeType) const {
+    uint64_t sum = 0;
+    for (int ply = 0; ply < MAX_PLY; ply++) sum += total(stat, nodeType, ply);
+    return sum;
+}
+
+uint64_t SearchStats::total(NodeStat stat) const {
+    uint64_t sum = 0;
+    for (int nt = 0; nt < NB_STATS_NODE_TYPE; nt++) sum += total(stat, nt);
+    return sum;
+}
+
+void SearchStats::print() const {
+    console << std::endl << "Search statistics" << std::endl;
+
+    // Per node type
+    console << std::left << std::setw(7) << "Type" << std::right
+            << std::setw(12) << "Nodes" << std::setw(9) << "TT hit" << std::setw(9) << "TT cut"
+            << std::setw(12) << "1st move" << std::setw(11) << "LMR re" << std::setw(11) << "NMP"
+            << std::setw(11) << "RFP" << std::setw(11) << "Razoring" << std::setw(11) << "SEE" << std::endl;
+
+    for (int nt = 0; nt < NB_STATS_NODE_TYPE; nt++) {
+        console << std::left << std::setw(7) << NODE_TYPE_NAMES[nt] << std::right
+                << std::setw(12) << total(STAT_NODES, nt)
+                << std::setw(9) << percent(total(STAT_TT_HITS, nt), total(STAT_TT_PROBES, nt))
+                << std::setw(9) << percent(total(STAT_TT_CUTOFFS, nt), total(STAT_TT_PROBES, nt))
+                << std::setw(12) << percent(total(STAT_FIRST_MOVE_CUTOFFS, nt), total(STAT_BETA_CUTOFFS, nt))
+                << std::setw(11) << percent(total(STAT_LMR_RESEARCHES, nt), total(STAT_LMR_SEARCHES, nt))
+                << std::setw(11) << percent(total(STAT_NMP_PRUNES, nt), total(STAT_NMP_TRIES, nt))
+                << std::setw(11) << total(STAT_RFP_PRUNES, nt)
+                << std::setw(11) << percent(total(STAT_RAZORING_PRUNES, nt), total(STAT_RAZORING_TRIES, nt))
+                << std::setw(11) << total(STAT_SEE_PRUNES, nt) << std::endl;
+    }
+
+    // Quiescence
+    console << std::endl << "QSearch nodes: " << total(STAT_QNODES)
+            << " TT hit: " << percent(total(STAT_QTT_HITS), total(STAT_QTT_PROBES))
+            << " TT cut: " << percent(total(STAT_QTT_CUTOFFS), total(STAT_QTT_PROBES))
+            << " Stand pat cut: " << percent(total(STAT_QSTANDPAT_CUTOFFS), total(STAT_QNODES))
+            << " SEE prunes: " << total(STAT_QSEE_PRUNES) << std::endl;
+
+    console << "QSearch depth:";
+    for (int depth = 0; depth < MAX_STATS_QSEARCH_DEPTH; depth++) {
+        uint64_t count = qsearchDepth[depth].load(std::memory_order_relaxed);
+        if (count) console << " " << depth << ":" << count;
+    }
+    console << std::endl;
+
+    // Move picker
+    console << "MovePicker: tt " << global[STAT_MP_TT_MOVES].load()
+            << " good tacticals " << global[STAT_MP_GOOD_TACTICALS].load()
+            << " refutations " << global[STAT_MP_REFUTATIONS].load()
+            << " good quiets " << global[STAT_MP_GOOD_QUIETS].load()
+            << " bad tacticals " << global[STAT_MP_BAD_TACTICALS].load()
+            << " bad quiets " << global[STAT_MP_BAD_QUIETS].load()
+            << " evasions " << global[STAT_MP_EVASIONS].load()
+            << " quiet checks " << global[STAT_MP_QUIET_CHECKS].load() << std::endl;
+
+    // Per ply, all node types
+    console << std::endl << std::setw(4) << "Ply" << std::setw(12) << "Nodes" << std::setw(12) << "QNodes"
+            << std::setw(9) << "TT hit" << std::setw(12) << "1st move" << std::setw(11) << "LMR re" << std::endl;
+
+    for (int ply = 0; ply < MAX_PLY; ply++) {
+        uint64_t counters[NB_NODE_STAT] = {};
+        for (int stat = 0; stat < NB_NODE_STAT; stat++)
+            for (int nt = 0; nt < NB_STATS_NODE_TYPE; nt++)
+                counters[stat] += total(NodeStat(stat), nt, ply);
+
+        if (!counters[STAT_NODES] && !counters[STAT_QNODES]) continue;
+
+        console << std::setw(4) << ply << std::setw(12) << counters[STAT_NODES] << std::setw(12) << counters[STAT_QNODES]
+                << std::setw(9) << percent(counters[STAT_TT_HITS], counters[STAT_TT_PROBES])
+                << std::setw(12) << percent(counters[STAT_FIRST_MOVE_CUTOFFS], counters[STAT_BETA_CUTOFFS])
+                << std::setw(11) << percent(counters[STAT_LMR_RESEARCHES], counters[STAT_LMR_SEARCHES]) << std::endl;
+    }
+}
+
+} /* namespace Belette */
@@ -0,0 +1,88 @@
+#ifndef STATS_H_INCLUDED
+#define STATS_H_INCLUDED
+
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include "chess.h"
+
+// Search statistics are only compiled in when STATS is defined (make stats), otherwise all macros are no-ops
+#ifdef STATS
+#define STATS_NODE(counter, nt, ply) Belette::searchStats.inc(Belette::counter, int(nt), ply)
+#define STATS_INC(counter) Belette::searchStats.inc(Belette::counter)
+#define STATS_QSEARCH_DEPTH(depth) Belette::searchStats.incQSearchDepth(depth)
+#else
+#define STATS_NODE(counter, nt, ply) ((void)0)
+#define STATS_INC(counter) ((void)0)
+#define STATS_QSEARCH_DEPTH(depth) ((void)0)
+#endif
+
+namespace Belette {
+
+// Counters recorded per node type and per ply
+enum NodeStat {
+    STAT_NODES,
+    STAT_TT_PROBES,
+    STAT_TT_HITS,
+    STAT_TT_CUTOFFS,
+    STAT_BETA_CUTOFFS,
+    STAT_FIRST_MOVE_CUTOFFS,
+    STAT_LMR_SEARCHES,
+    STAT_LMR_RESEARCHES,
+    STAT_NMP_TRIES,
+    STAT_NMP_PRUNES,
+    STAT_RFP_PRUNES,
+    STAT_RAZORING_TRIES,
+    STAT_RAZORING_PRUNES,
+    STAT_SEE_PRUNES,
+    STAT_QNODES,
+    STAT_QTT_PROBES,
+    STAT_QTT_HITS,
+    STAT_QTT_CUTOFFS,
+    STAT_QSTANDPAT_CUTOFFS,
+    STAT_QSEE_PRUNES,
+    NB_NODE_STAT
+};
+
+// Global counters (move picker)
+enum GlobalStat {
+    STAT_MP_TT_MOVES,
+    STAT_MP_GOOD_TACTICALS,
+    STAT_MP_REFUTATIONS,
+    STAT_MP_GOOD_QUIETS,
+    STAT_MP_BAD_TACTICALS,
+    STAT_MP_BAD_QUIETS,
+    STAT_MP_EVASIONS,
+    STAT_MP_QUIET_CHECKS,
+    NB_GLOBAL_STAT
+};
+
+constexpr int NB_STATS_NODE_TYPE = 3; // Root, PV, NonPV (see NodeType)
+constexpr int MAX_STATS_QSEARCH_DEPTH = 32;
+
+class SearchStats {
+public:
+    inline void inc(NodeStat stat, int nodeType, int ply) { nodes[stat][nodeType][std::min(ply, MAX_PLY-1)].fetch_add(1, std::memory_order_relaxed); }
+    inline void inc(GlobalStat stat) { global[stat].fetch_add(1, std::memory_order_relaxed); }
+    inline void incQSearchDepth(int depth) { qsearchDepth[std::min(depth, MAX_STATS_QSEARCH_DEPTH-1)].fetch_add(1, std::memory_order_relaxed); }
+
+    void clear();
+    void print() const;
+
+private:
+    std::atomic<uint64_t> nodes[NB_NODE_STAT][NB_STATS_NODE_TYPE][MAX_PLY] = {};
+    std::atomic<uint64_t> global[NB_GLOBAL_STAT] = {};
+    std::atomic<uint64_t> qsearchDepth[MAX_STATS_QSEARCH_DEPTH] = {};
+
+    uint64_t total(NodeStat stat) const;
+    uint64_t total(NodeStat stat, int nodeType) const;
+    uint64_t total(NodeStat stat, int nodeType, int ply) const { return nodes[stat][nodeType][ply].load(std::memory_order_relaxed); }
+};
+
+#ifdef STATS
+extern SearchStats searchStats;
+#endif
+
+} /* namespace Belette */
+
+#endif /* STATS_H_INCLUDED */
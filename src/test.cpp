@@ -2,9 +2,13 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <algorithm>
+#include <functional>
+#include <memory>
 #include "test.h"
 #include "uci.h"
 #include "position.h"
+#include "movegen.h"
 #include "perft.h"
 
 namespace Belette::Test {
@@ -28,9 +32,88 @@ std::vector<TestCase> ALL_TESTS = {
     {"3k4/8/8/2KpP2r/8/8/8/8 w - - 0 2", 6, 1441479}                                        // En passant
 };
 
+// Specialized move generation checked against a brute force on the legal moves, at every node of a perft of
+// CONSISTENCY_DEPTH from each perft position
+struct ConsistencyTest {
+    std::string name;
+    std::function<bool(Position &pos)> check;
+};
+
+constexpr int CONSISTENCY_DEPTH = 3;
+
+static bool checkQuietChecks(Position &pos) {
+    if (pos.inCheck()) return true; // Not generated in check
+
+    MoveList legalMoves;
+    std::vector<Move> expected, generated;
+
+    generateLegalMoves(pos, legalMoves);
+    for (Move m : legalMoves) {
+        if (pos.isCapture(m) || moveType(m) == PROMOTION || moveType(m) == CASTLING) continue;
+
+        pos.doMove(m);
+        if (pos.inCheck()) expected.push_back(m);
+        pos.undoMove(m);
+    }
+
+    enumerateLegalMoves<QUIET_CHECKS>(pos, [&](Move m) {
+        generated.push_back(m); return true;
+    });
+
+    std::sort(expected.begin(), expected.end());
+    std::sort(generated.begin(), generated.end());
+
+    return expected == generated;
+}
+
+static bool checkGivesCheck(Position &pos) {
+    MoveList legalMoves;
+    bool ok = true;
+
+    generateLegalMoves(pos, legalMoves);
+    for (Move m : legalMoves) {
+        bool givesCheck = pos.givesCheck(m);
+
+        pos.doMove(m);
+        ok &= givesCheck == pos.inCheck();
+        pos.undoMove(m);
+    }
+
+    return ok;
+}
+
+static bool checkLegalMoveCount(Position &pos) {
+    MoveList legalMoves;
+    generateLegalMoves(pos, legalMoves);
+
+    return countLegalMoves(pos) == int(legalMoves.size()) && hasLegalMove(pos) == !legalMoves.empty();
+}
+
+std::vector<ConsistencyTest> CONSISTENCY_TESTS = {
+    {"Quiet checks", checkQuietChecks},
+    {"Gives check", checkGivesCheck},
+    {"Legal move count", checkLegalMoveCount}
+};
+
+// Number of positions failing the check
+static size_t walk(Position &pos, int depth, const ConsistencyTest &test) {
+    size_t nbFailed = !test.check(pos);
+    if (depth == 0) return nbFailed;
+
+    MoveList moves;
+    generateLegalMoves(pos, moves);
+    for (Move m : moves) {
+        pos.doMove(m);
+        nbFailed += walk(pos, depth - 1, test);
+        pos.undoMove(m);
+    }
+
+    return nbFailed;
+}
+
 void run() {
     Position pos;
-    int i = 1, nbTest = ALL_TESTS.size(), nbFailed = 0;
+    int i = 1, nbTest = ALL_TESTS.size() + CONSISTENCY_TESTS.size(), nbFailed = 0;
 
     for(auto t : ALL_TESTS) {
         console << "[Test " << i << "/" << nbTest << "] \"" << t.fen << "\"" << std::endl;
@@ -48,6 +131,26 @@ void run() {
         i++;
     }
 
+    for (auto &t : CONSISTENCY_TESTS) {
+        console << "[Test " << i << "/" << nbTest << "] " << t.name << std::endl;
+
+        size_t failed = 0;
+        for (auto &perftTest : ALL_TESTS) {
+            auto testPos = std::make_unique<Position>();
+            testPos->setFromFEN(perftTest.fen);
+            failed += walk(*testPos, CONSISTENCY_DEPTH, t);
+        }
+
+        if (failed == 0) {
+            console << "  SUCCESS - all positions up to depth " << CONSISTENCY_DEPTH << std::endl;
+        } else {
+            console << "  FAILED! - " << failed << " positions" << std::endl;
+            nbFailed++;
+        }
+
+        i++;
+    }
+
     console << std::endl << std::endl;
 
     if (nbFailed > 0) {
@@ -4,8 +4,8 @@
 
 namespace Belette {
 
-// Global Transposition Table
-TranspositionTable tt;
+// Global Transposition Table, allocated by main() so that loading the library doesn't allocate it
+TranspositionTable tt(0);
 
 TranspositionTable::TranspositionTable(size_t defaultSize): buckets(nullptr), nbBuckets(0), age(0) {
     resize(defaultSize);
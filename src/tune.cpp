@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "tune.h"
+#include "evaluate.h"
+#include "packedpos.h"
+#include "uci.h"
+#include "utils.h"
+
+namespace Belette {
+
+// Evaluation is linear in its parameters: material and piece square values of each piece type and phase
+constexpr int NB_PSQT_PARAMS = int(NB_PIECE_TYPE) * int(NB_SQUARE) * int(NB_PHASE);
+constexpr int NB_TUNE_PARAMS = NB_PSQT_PARAMS + int(NB_PIECE_TYPE) * int(NB_PHASE);
+
+constexpr int psqtParam(PieceType pt, Square sq, Phase p) { return (int(pt) * NB_SQUARE + int(sq)) * NB_PHASE + p; }
+constexpr int materialParam(PieceType pt, Phase p) { return NB_PSQT_PARAMS + int(pt) * NB_PHASE + p; }
+
+using TuneVector = std::array<double, NB_TUNE_PARAMS>;
+
+// Positions are stored as one feature per piece: bit 15 set for black, piece type in bits 6-8, relative square in bits 0-5
+struct TuneEntry {
+    uint32_t firstFeature;
+    uint8_t nbFeatures;
+    uint8_t phase;
+    int8_t sideToMove; // 1 for white, -1 for black (tempo)
+    float result; // 1.0 white win, 0.5 draw, 0.0 black win
+};
+
+struct TuneDataset {
+    std::vector<TuneEntry> entries;
+    std::vector<uint16_t> features;
+};
+
+constexpr size_t TUNE_BLOCK_SIZE = 256;
+static const char* PIECE_TYPE_NAMES[NB_PIECE_TYPE] = { "", "Pawn", "Knight", "Bishop", "Rook", "Queen", "King" };
+
+static void addPosition(TuneDataset &data, const Position &pos, float result) {
+    TuneEntry entry;
+    entry.firstFeature = uint32_t(data.features.size());
+    entry.nbFeatures = uint8_t(popcount(pos.getPiecesBB()));
+    entry.phase = uint8_t(gamePhase(pos));
+    entry.sideToMove = pos.getSideToMove() == WHITE ? 1 : -1;
+    entry.result = result;
+
+    Bitboard pieces = pos.getPiecesBB();
+    bitscan_loop(pieces) {
+        Square sq = bitscan(pieces);
+        Piece pc = pos.getPieceAt(sq);
+        Side s = side(pc);
+
+        data.features.push_back(uint16_t((int(s) << 15) | (int(pieceType(pc)) << 6) | int(relativeSquare(s, sq))));
+    }
+
+    data.entries.push_back(entry);
+}
+
+static bool parseResultToken(std::string token, float &result) {
+    token.erase(std::remove_if(token.begin(), token.end(), [](char c) { return c == '"' || c == ';'; }), token.end());
+
+    if (token == "1-0") result = 1.0f;
+    else if (token == "0-1") result = 0.0f;
+    else if (token == "1/2-1/2") result = 0.5f;
+    else if (token.size() > 2 && token.front() == '[' && token.back() == ']') result = float(parseDouble(token.substr(1, token.size() - 2)));
+    else return false;
+
+    return true;
+}
+
+// Text line: FEN (counters are optional) followed by its result, see tune.h for the supported formats
+static bool parseTuneLine(const std::string &line, Position &pos, float &result) {
+    std::istringstream parser(line);
+    std::string fields[4];
+
+    for (int i=0; i<4; i++) {
+        if (!(parser >> fields[i])) return false;
+    }
+
+    size_t sep = line.rfind('|');
+    if (sep != std::string::npos) {
+        std::string value = line.substr(sep + 1);
+        value.erase(0, value.find_first_not_of(" \t"));
+
+        result = value.starts_with("1.0") || value.starts_with("1-0") ? 1.0f
+               : value.starts_with("0.0") || value.starts_with("0-1") ? 0.0f
+               : 0.5f;
+    } else {
+        std::string token;
+        bool found = false;
+        while (!found && parser >> token) found = parseResultToken(token, result);
+        if (!found) return false;
+    }
+
+    return pos.setFromFEN(fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3] + " 0 1");
+}
+
+static bool loadDataset(const TuneParams &params, TuneDataset &data) {
+    bool binary = params.filename.ends_with(".bin");
+    std::ifstream file(params.filename, binary ? std::ios::binary : std::ios::in);
+    if (!file.is_open()) return false;
+
+    size_t limit = params.maxPositions ? params.maxPositions : SIZE_MAX;
+    Position pos;
+
+    if (binary) {
+        PackedPosition packed;
+        while (data.entries.size() < limit && file.read(reinterpret_cast<char *>(&packed), sizeof(packed))) {
+            if (pos.setFromFEN(unpackFen(packed)))
+                addPosition(data, pos, packed.result / 2.0f);
+        }
+    } else {
+        std::string line;
+        float result = 0.5f;
+        while (data.entries.size() < limit && std::getline(file, line)) {
+            if (parseTuneLine(line, pos, result))
+                addPosition(data, pos, result);
+        }
+    }
+
+    data.entries.shrink_to_fit();
+    data.features.shrink_to_fit();
+
+    return true;
+}
+
+static TuneVector initialParams() {
+    TuneVector params{};
+
+    for (PieceType pt : {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING}) {
+        for (Phase p : {MG, EG}) {
+            params[materialParam(pt, p)] = PIECE_TYPE_VALUE[pt][p];
+
+            for (Square sq=SQ_A1; sq<NB_SQUARE; ++sq)
+                params[psqtParam(pt, sq, p)] = PSQT[pt][p][sq];
+        }
+    }
+
+    return params;
+}
+
+// Same as evaluate() from white point of view, without rounding
+static inline double evaluateEntry(const TuneDataset &data, const TuneEntry &entry, const TuneVector &params) {
+    double score[NB_PHASE] = {};
+    const uint16_t *features = &data.features[entry.firstFeature];
+
+    for (int i = 0; i < entry.nbFeatures; i++) {
+        PieceType pt = PieceType((features[i] >> 6) & 7);
+        Square sq = Square(features[i] & 63);
+        double sign = features[i] >> 15 ? -1.0 : 1.0;
+
+        score[MG] += sign * (params[materialParam(pt, MG)] + params[psqtParam(pt, sq, MG)]);
+        score[EG] += sign * (params[materialParam(pt, EG)] + params[psqtParam(pt, sq, EG)]);
+    }
+
+    return (score[MG] * entry.phase + score[EG] * (PHASE_TOTAL - entry.phase)) / PHASE_TOTAL + entry.sideToMove * Tempo;
+}
+
+// Sum of squared errors on [begin, end), and its gradient (without the constant factor) if requested
+static double computeRange(const TuneDataset &data, size_t begin, size_t end, const TuneVector &params, double K, TuneVector *gradient) {
+    double eval[TUNE_BLOCK_SIZE], result[TUNE_BLOCK_SIZE], derivative[TUNE_BLOCK_SIZE];
+    double loss = 0;
+
+    for (size_t block = begin; block < end; block += TUNE_BLOCK_SIZE) {
+        size_t size = std::min(TUNE_BLOCK_SIZE, end - block);
+
+        for (size_t i = 0; i < size; i++) {
+            eval[i] = evaluateEntry(data, data.entries[block + i], params);
+            result[i] = data.entries[block + i].result;
+        }
+
+        // Loss of the whole block in a separate branch free loop, which the compiler can vectorize
+        for (size_t i = 0; i < size; i++) {
+            double sigmoid = 1.0 / (1.0 + std::exp(-K * eval[i]));
+            double error = sigmoid - result[i];
+            loss += error * error;
+            derivative[i] = error * sigmoid * (1.0 - sigmoid);
+        }
+
+        if (!gradient) continue;
+
+        for (size_t i = 0; i < size; i++) {
+            const TuneEntry &entry = data.entries[block + i];
+            const uint16_t *features = &data.features[entry.firstFeature];
+            double mg = derivative[i] * entry.phase / PHASE_TOTAL;
+            double eg = derivative[i] * (PHASE_TOTAL - entry.phase) / PHASE_TOTAL;
+
+            for (int j = 0; j < entry.nbFeatures; j++) {
+                PieceType pt = PieceType((features[j] >> 6) & 7);
+                Square sq = Square(features[j] & 63);
+                double sign = features[j] >> 15 ? -1.0 : 1.0;
+
+                (*gradient)[materialParam(pt, MG)] += sign * mg;
+                (*gradient)[psqtParam(pt, sq, MG)] += sign * mg;
+                (*gradient)[materialParam(pt, EG)] += sign * eg;
+                (*gradient)[psqtParam(pt, sq, EG)] += sign * eg;
+            }
+        }
+    }
+
+    return loss;
+}
+
+// Mean squared error over the dataset, split between threads. The gradient is summed if requested
+static double computeLoss(const TuneDataset &data, const TuneVector &params, double K, int nbThreads, TuneVector *gradient = nullptr) {
+    size_t size = data.entries.size();
+    size_t chunk = (size + nbThreads - 1) / nbThreads;
+
+    std::vector<std::thread> threads;
+    std::vector<double> losses(nbThreads, 0.0);
+    std::vector<TuneVector> gradients(gradient ? nbThreads : 0, TuneVector{});
+
+    for (int t = 0; t < nbThreads; t++) {
+        size_t begin = std::min(size, t * chunk), end = std::min(size, begin + chunk);
+
+        threads.emplace_back([&, t, begin, end]() {
+            losses[t] = computeRange(data, begin, end, params, K, gradient ? &gradients[t] : nullptr);
+        });
+    }
+
+    for (auto &thread : threads) thread.join();
+
+    double loss = 0;
+    for (int t = 0; t < nbThreads; t++) {
+        loss += losses[t];
+
+        if (gradient) {
+            for (int i = 0; i < NB_TUNE_PARAMS; i++) (*gradient)[i] += gradients[t][i];
+        }
+    }
+
+    return loss / std::max<size_t>(size, 1);
+}
+
+// Sigmoid scaling which best fits the current evaluation (golden section search)
+static double findBestK(const TuneDataset &data, const TuneVector &params, int nbThreads) {
+    constexpr double ratio = 0.6180339887498949;
+    double low = 0.0, high = 0.02;
+
+    for (int i = 0; i < 40; i++) {
+        double k1 = high - ratio * (high - low), k2 = low + ratio * (high - low);
+
+        if (computeLoss(data, params, k1, nbThreads) < computeLoss(data, params, k2, nbThreads))
+            high = k2;
+        else
+            low = k1;
+    }
+
+    return (low + high) / 2;
+}
+
+// Material and piece square values are redundant: move the average of each table into the material value
+static void normalizeParams(TuneVector &params) {
+    for (PieceType pt : {PAWN, KNIGHT, BISHOP, ROOK, QUEEN}) {
+        for (Phase p : {MG, EG}) {
+            Bitboard squares = pt == PAWN ? ~(Rank1BB | Rank8BB) : ~0ULL;
+            double sum = 0;
+
+            for (Bitboard b = squares; b; b &= b - 1) sum += params[psqtParam(pt, bitscan(b), p)];
+
+            double mean = sum / popcount(squares);
+            params[materialParam(pt, p)] += mean;
+            for (Bitboard b = squares; b; b &= b - 1) params[psqtParam(pt, bitscan(b), p)] -= mean;
+        }
+    }
+}
+
+static void printParams(std::ostream &out, const TuneVector &params) {
+    for (PieceType pt : {PAWN, KNIGHT, BISHOP, ROOK, QUEEN}) {
+        out << "constexpr Score " << PIECE_TYPE_NAMES[pt] << "ValueMg = " << std::lround(params[materialParam(pt, MG)]) << ";" << std::endl;
+        out << "constexpr Score " << PIECE_TYPE_NAMES[pt] << "ValueEg = " << std::lround(params[materialParam(pt, EG)]) << ";" << std::endl;
+        out << std::endl;
+    }
+
+    out << "constexpr Score PSQT[NB_PIECE_TYPE][NB_PHASE][NB_SQUARE] = {" << std::endl;
+    out << "    {}," << std::endl;
+
+    for (PieceType pt : {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING}) {
+        out << "    // " << PIECE_TYPE_NAMES[pt] << std::endl << "    {" << std::endl;
+
+        for (Phase p : {MG, EG}) {
+            out << "        {" << std::endl;
+
+            for (int r = RANK_1; r <= RANK_8; r++) {
+                out << "           ";
+                for (int f = FILE_A; f <= FILE_H; f++)
+                    out << std::setw(4) << std::lround(params[psqtParam(pt, square(File(f), Rank(r)), p)]) << ",";
+                out << std::endl;
+            }
+
+            out << "        }" << (p == MG ? "," : "") << std::endl;
+        }
+
+        out << "    }" << (pt != KING ? "," : "") << std::endl;
+    }
+
+    out << "};" << std::endl;
+}
+
+void tune(const TuneParams &params) {
+    TuneDataset data;
+    TimeMs start = now();
+    int nbThreads = std::max(1, params.nbThreads);
+
+    if (!loadDataset(params, data) || data.entries.empty()) {
+        console << "Unable to load positions from '" << params.filename << "'" << std::endl;
+        return;
+    }
+
+    console << "Loaded " << data.entries.size() << " positions in " << (now() - start) << "ms" << std::endl;
+
+    TuneVector weights = initialParams();
+    double K = findBestK(data, weights, nbThreads);
+
+    console << "K: " << K << " initial loss: " << std::setprecision(8) << computeLoss(data, weights, K, nbThreads) << std::endl;
+
+    // Adam optimizer on the full dataset
+    constexpr double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+    TuneVector momentum{}, velocity{};
+    start = now();
+
+    for (int epoch = 1; epoch <= params.epochs; epoch++) {
+        TuneVector gradient{};
+        double loss = computeLoss(data, weights, K, nbThreads, &gradient);
+
+        for (int i = 0; i < NB_TUNE_PARAMS; i++) {
+            momentum[i] = beta1 * momentum[i] + (1 - beta1) * gradient[i];
+            velocity[i] = beta2 * velocity[i] + (1 - beta2) * gradient[i] * gradient[i];
+
+            double m = momentum[i] / (1 - std::pow(beta1, epoch));
+            double v = velocity[i] / (1 - std::pow(beta2, epoch));
+            weights[i] -= params.learningRate * m / (std::sqrt(v) + epsilon);
+        }
+
+        if (epoch % 10 == 0 || epoch == params.epochs)
+            console << "Epoch " << epoch << " loss: " << std::setprecision(8) << loss << " elapsed: " << (now() - start) << "ms" << std::endl;
+    }
+
+    normalizeParams(weights);
+    console << "Final loss: " << std::setprecision(8) << computeLoss(data, weights, K, nbThreads) << std::endl;
+
+    if (params.output.empty()) {
+        std::ostringstream out;
+        printParams(out, weights);
+        console << out.str();
+    } else {
+        std::ofstream out(params.output);
+        printParams(out, weights);
+        console << "Tuned values written to " << params.output << std::endl;
+    }
+}
+
+} /* namespace Belette */
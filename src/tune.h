@@ -0,0 +1,24 @@
+#ifndef TUNE_H_INCLUDED
+#define TUNE_H_INCLUDED
+
+#include <string>
+
+namespace Belette {
+
+struct TuneParams {
+    std::string filename;
+    std::string output; // Tuned tables are printed on the console if empty
+    int nbThreads = 1;
+    int epochs = 500;
+    double learningRate = 1.0; // In centipawns
+    size_t maxPositions = 0; // 0 to load the whole dataset
+};
+
+// Texel tuning of the material and piece square values of evaluate.h on a labeled dataset
+// Dataset is a packed binary file (.bin, see datagen) or a text file with one FEN and its result per line:
+// "<fen> | <score> | 1.0", "<fen> [0.5]" or "<fen> c9 "0-1";"
+void tune(const TuneParams &params);
+
+} /* namespace Belette */
+
+#endif /* TUNE_H_INCLUDED */
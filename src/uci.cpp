@@ -8,34 +8,131 @@
 #include "utils.h"
 #include "movepicker.h"
 #include "bench.h"
+#include "analyse.h"
+#include "selfplay.h"
+#include "server.h"
+#include "datagen.h"
+#include "packedpos.h"
+#include "tune.h"
+#include "stats.h"
+#include "cpu.h"
 
 namespace Belette {
 
 Console console;
 
+Console::Console() {
+    head = tail = new Line(); // stub
+}
+
 Console::~Console() {
+    if (writer.joinable()) {
+        stopping = true;
+        nbPushed.fetch_add(1, std::memory_order_release);
+        nbPushed.notify_one();
+        writer.join();
+    }
+
+    delete tail;
     if (file != nullptr) delete file;
 }
 
+void Console::push(std::string &&text, bool isInput) {
+    std::call_once(writerStarted, [this] { writer = std::thread(&Console::writerLoop, this); });
+
+    Line *line = new Line();
+    line->text = std::move(text);
+    line->time = logging.load(std::memory_order_relaxed) ? time(nullptr) : 0;
+    line->isInput = isInput;
+
+    Line *prev = head.exchange(line, std::memory_order_acq_rel);
+    prev->next.store(line, std::memory_order_release);
+
+    nbPushed.fetch_add(1, std::memory_order_release);
+    nbPushed.notify_one();
+}
+
+// Write every queued line with a single flush per batch
+void Console::writeLines() {
+    std::string out, log;
+    bool toFile = logging.load(std::memory_order_relaxed);
+
+    while (Line *next = tail->next.load(std::memory_order_acquire)) {
+        delete tail;
+        tail = next;
+
+        if (!next->isInput) out += next->text;
+
+        if (toFile) {
+            std::ostringstream ss;
+            ss << "[" << std::put_time(std::localtime(&next->time), "%F %T") << "] " << (next->isInput ? "<< " : ">> ") << next->text;
+            log += ss.str();
+        }
+
+        next->text = std::string();
+    }
+
+    if (!out.empty()) {
+        std::cout.write(out.data(), out.size());
+        std::cout.flush();
+    }
+
+    if (!log.empty()) {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        if (file != nullptr) {
+            (*file) << log;
+            file->flush();
+        }
+    }
+}
+
+void Console::writerLoop() {
+    while (true) {
+        uint64_t pushed = nbPushed.load(std::memory_order_acquire);
+        writeLines();
+
+        nbWritten.store(pushed, std::memory_order_release);
+        nbWritten.notify_all();
+
+        if (stopping && tail->next.load(std::memory_order_acquire) == nullptr) break;
+
+        nbPushed.wait(pushed, std::memory_order_acquire);
+    }
+}
+
+void Console::flush() {
+    uint64_t target = nbPushed.load(std::memory_order_acquire);
+    uint64_t written;
+
+    while ((written = nbWritten.load(std::memory_order_acquire)) < target)
+        nbWritten.wait(written, std::memory_order_acquire);
+}
+
 std::istream& Console::getline(std::string& x) {
     std::getline(std::cin, x);
-    console.log(x, true).log('\n');
+    if (logging.load(std::memory_order_relaxed)) push(x + '\n', true);
     return std::cin;
 }
 
 void Console::setLogFile(const std::string &filename) {
+    std::lock_guard<std::mutex> lock(fileMutex);
     if (file != nullptr) delete file;
-    file = new std::ofstream(filename, std::ios::app);
+    file = filename.empty() ? nullptr : new std::ofstream(filename, std::ios::app);
+    logging = file != nullptr;
 }
 
 Uci::Uci()  {
-    console << "Belette " << VERSION << " by Vincent Bab" << std::endl;
+    console << "Belette " << VERSION << " (" << CPU::buildArch() << " " << SLIDER_ATTACKS << ") by Vincent Bab" << std::endl;
     
     options["Debug Log File"] = UciOption("", [&] (const UciOption &opt) { console.setLogFile(opt); });
+    options["HistoryDecay"] = UciOption(0, 0, 64, [&] (const UciOption &opt) { engine.setHistoryDecay(int64_t(opt)); });
     options["Hash"] = UciOption(64, 1, 1048576, [&] (const UciOption &opt) { 
         engine.setHashSize(int64_t(opt)*1024*1024);
     });
+    options["Ponder"] = UciOption(false);
     options["Threads"] = UciOption(1, 1, 1);
+    options["OwnBook"] = UciOption(false, [&] (const UciOption &opt) { updateBook(); });
+    options["BookFile"] = UciOption("", [&] (const UciOption &opt) { updateBook(); });
 
     commands["uci"] = &Uci::cmdUci;
     commands["isready"] = &Uci::cmdIsReady;
@@ -44,6 +141,7 @@ Uci::Uci()  {
     commands["position"] = &Uci::cmdPosition;
     commands["go"] = &Uci::cmdGo;
     commands["stop"] = &Uci::cmdStop;
+    commands["ponderhit"] = &Uci::cmdPonderHit;
     commands["quit"] = &Uci::cmdQuit;
 
     commands["debug"] = &Uci::cmdDebug;
@@ -53,6 +151,12 @@ Uci::Uci()  {
     commands["perftmp"] = &Uci::cmdPerftmp;
     commands["test"] = &Uci::cmdTest;
     commands["bench"] = &Uci::cmdBench;
+    commands["analyse"] = &Uci::cmdAnalyse;
+    commands["annotate"] = &Uci::cmdAnnotate;
+    commands["server"] = &Uci::cmdServer;
+    commands["selfplay"] = &Uci::cmdSelfPlay;
+    commands["datagen"] = &Uci::cmdDataGen;
+    commands["tune"] = &Uci::cmdTune;
 }
 
 Square Uci::parseSquare(std::string str) {
@@ -102,10 +206,14 @@ std::string Uci::formatMove(Move m) {
 }
 
 Move Uci::parseMove(std::string str) const {
+    return parseMove(engine.position(), str);
+}
+
+Move Uci::parseMove(const Position &pos, std::string str) {
     if (str.length() == 5) str[4] = char(tolower(str[4]));
 
-    Move move;
-    enumerateLegalMoves(engine.position(), [&](Move m) {
+    Move move = MOVE_NONE;
+    enumerateLegalMoves(pos, [&](Move m) {
         if (str == formatMove(m)) {
             move = m;
             return false;
@@ -117,45 +225,104 @@ Move Uci::parseMove(std::string str) const {
     return move;
 }
 
-void Uci::loop(int argc, char* argv[]) {
-    if (argc > 1 && std::string(argv[1]) == "bench") {
-        int depth = DEFAULT_BENCH_DEPTH;
-        if (argc > 2) depth = parseInt(std::string(argv[2]));
+// Arguments of the position command, returns false if the FEN is invalid
+bool Uci::parsePosition(std::istringstream& is, Position &pos) {
+    std::string token, fen;
 
-        bench(depth);
+    is >> token;
 
-        return;
+    if (token == "startpos") {
+        fen = STARTPOS_FEN;
+    } else if (token == "kiwipete") {
+        fen = KIWIPETE_FEN;
+    } else if (token == "fen") {
+        while (is >> token && token != "moves") {
+            fen += token + " ";
+        }
+    } else {
+        return true;
     }
 
+    if (!pos.setFromFEN(fen)) return false;
 
-    std::string line, token;
-
-    while(console.getline(line)) {
-        std::istringstream parser(line);
-
-        if (line.empty()) continue;
+    while (is >> token) {
+        Move m = parseMove(pos, token);
+        
+        if (m == MOVE_NONE) continue;
 
-        token.clear();
-        parser >> std::skipws >> token;
+        pos.doMove(m);
+    }
 
-        bool unknowCommand = true, exit = false;
-        for (auto const& [cmd, handler] : commands) {
-            if (cmd != token) continue;
+    return true;
+}
 
-            unknowCommand = false;
+// Arguments of the go command
+SearchLimits Uci::parseSearchLimits(std::istringstream& is, const Position &pos) {
+    std::string token;
+    SearchLimits params;
 
-            if (!(this->*handler)(parser)) {
-                exit = true;
+    while (is >> token) {
+        if (token == "searchmoves") {
+            while (is >> token) {
+                Move m = parseMove(pos, token);
+                params.searchMoves.push_back(m);
             }
-
-            break;
+        } else if (token == "ponder") {
+            params.ponder = true;
+        } else if (token == "wtime") {
+            is >> token;
+            params.timeLeft[WHITE] = parseInt(token);
+        } else if (token == "btime") {
+            is >> token;
+            params.timeLeft[BLACK] = parseInt(token);
+        } else if (token == "winc") {
+            is >> token;
+            params.increment[WHITE] = parseInt(token);
+        } else if (token == "binc") {
+            is >> token;
+            params.increment[BLACK] = parseInt(token);
+        } else if (token == "movestogo") {
+            is >> token;
+            params.movesToGo = parseInt(token);
+        } else if (token == "depth") {
+            is >> token;
+            params.maxDepth = parseInt(token);
+        } else if (token == "nodes") {
+            is >> token;
+            params.maxNodes = parseInt(token);
+        } else if (token == "mate") {
+            is >> token;
+            params.mate = parseInt(token);
+        } else if (token == "movetime") {
+            is >> token;
+            params.maxTime = parseInt(token);
+        } else if (token == "infinite") {
+            params.infinite = true;
         }
+    }
 
-        if (unknowCommand) {
-            console << "Unknow command '" << token << "'" << std::endl;
+    return params;
+}
+
+void Uci::loop(int argc, char* argv[]) {
+    // Command given on the command line (ie: "belette bench 15"), execute it and exit
+    if (argc > 1) {
+        std::string line;
+        for (int i=1; i<argc; i++) {
+            line += (i > 1 ? " " : "") + std::string(argv[i]);
         }
 
-        if (exit) {
+        execute(line);
+
+        return;
+    }
+
+    std::string line;
+
+    while(console.getline(line)) {
+        if (line.empty()) continue;
+
+        if (!execute(line)) {
             break;
         }
     }
@@ -164,6 +331,40 @@ void Uci::loop(int argc, char* argv[]) {
     console << "Exiting UCI loop" << std::endl;
 }
 
+bool Uci::execute(const std::string &line) {
+    std::istringstream parser(line);
+    std::string token;
+
+    parser >> std::skipws >> token;
+
+    for (auto const& [cmd, handler] : commands) {
+        if (cmd != token) continue;
+
+        return (this->*handler)(parser);
+    }
+
+    console << "Unknow command '" << token << "'" << std::endl;
+
+    return true;
+}
+
+// Open the book when OwnBook is set, the engine then plays book moves without searching
+void Uci::updateBook() {
+    book.close();
+    engine.setBook(nullptr);
+
+    std::string filename = options["BookFile"];
+    if (!options["OwnBook"] || filename.empty()) return;
+
+    if (!book.open(filename)) {
+        console << "info string Unable to open book " << filename << std::endl;
+        return;
+    }
+
+    engine.setBook(&book);
+    console << "info string Book " << filename << " loaded, " << book.size() << " entries" << std::endl;
+}
+
 bool Uci::cmdUci(std::istringstream &is) {
     console << "id name Belette " << VERSION << std::endl;
     console << "id author Vincent Bab" << std::endl;
@@ -186,6 +387,8 @@ bool Uci::cmdIsReady(std::istringstream& is) {
 }
 
 bool Uci::cmdUciNewGame(std::istringstream& is) {
+    engine.stop();
+    engine.waitForSearchFinish();
     engine.newGame();
     return true;
 }
@@ -212,33 +415,13 @@ bool Uci::cmdSetOption(std::istringstream& is) {
 }
 
 bool Uci::cmdPosition(std::istringstream& is) {
-    std::string token, fen;
-
-    is >> token;
-
-    if (token == "startpos") {
-        fen = STARTPOS_FEN;
-    } else if (token == "kiwipete") {
-        fen = KIWIPETE_FEN;
-    } else if (token == "fen") {
-        while (is >> token && token != "moves") {
-            fen += token + " ";
-        }
-    } else {
-        return true;
-    }
+    // The GUI may answer the bestmove before the search thread has returned, or not stop an infinite or ponder
+    // search before sending a new position
+    engine.stop();
+    engine.waitForSearchFinish();
 
-    if (!engine.position().setFromFEN(fen)) {
+    if (!parsePosition(is, engine.position())) {
         console << "Invalid FEN position" << std::endl;
-        return true;
-    }
-
-    while (is >> token) {
-        Move m = parseMove(token);
-        
-        if (m == MOVE_NONE) continue;
-
-        engine.position().doMove(m);
     }
 
     return true;
@@ -246,52 +429,24 @@ bool Uci::cmdPosition(std::istringstream& is) {
 
 bool Uci::cmdGo(std::istringstream& is) {
     std::string token;
-    SearchLimits params;
 
-    while (is >> token) {
-        if (token == "perft") {
-            return cmdPerft(is);
-        } else if (token == "perftmp") {
-            return cmdPerftmp(is);
-        } else if (token == "searchmoves") {
-            while (is >> token) {
-                Move m = Uci::parseMove(token);
-                params.searchMoves.push_back(m);
-            }
-        } else if (token == "ponder") {
-            // unsupported
-        } else if (token == "wtime") {
-            is >> token;
-            params.timeLeft[WHITE] = parseInt(token);
-        } else if (token == "btime") {
-            is >> token;
-            params.timeLeft[BLACK] = parseInt(token);
-        } else if (token == "winc") {
-            is >> token;
-            params.increment[WHITE] = parseInt(token);
-        } else if (token == "binc") {
-            is >> token;
-            params.increment[BLACK] = parseInt(token);
-        } else if (token == "movestogo") {
-            is >> token;
-            params.movesToGo = parseInt(token);
-        } else if (token == "depth") {
-            is >> token;
-            params.maxDepth = parseInt(token);
-        } else if (token == "nodes") {
-            is >> token;
-            params.maxNodes = parseInt(token);
-        } else if (token == "mate") {
-            // unsupported
-        } else if (token == "movetime") {
-            is >> token;
-            params.maxTime = parseInt(token);
-        } else if (token == "infinite") {
-             
-        }
+    engine.stop();
+    engine.waitForSearchFinish();
+    engine.clearPonderhit();
+
+    std::streampos start = is.tellg();
+    is >> token;
+
+    if (token == "perft") {
+        return cmdPerft(is);
+    } else if (token == "perftmp") {
+        return cmdPerftmp(is);
     }
 
-    engine.search(params);
+    is.clear();
+    is.seekg(start);
+
+    engine.search(parseSearchLimits(is, engine.position()));
     return true;
 }
 
@@ -305,7 +460,8 @@ bool Uci::cmdDebug(std::istringstream& is) {
             return true;
         });
     } else if (token == "movepicker") {
-        MovePicker mp(engine.position());
+        auto arena = std::make_unique<MoveArena>();
+        MovePicker mp(engine.position(), *arena);
 
         mp.enumerate<MAIN>([&] (Move m, bool& skipQuiets) {
             console << Uci::formatMove(m) << std::endl;
@@ -323,7 +479,19 @@ bool Uci::cmdDebug(std::istringstream& is) {
         is >> token;
         int threshold = parseInt(token);
 
-        console << Uci::formatMove(m) << "/" << threshold << " => " << (engine.position().see(m, threshold) ? "PASS" : "FAIL") << std::endl;
+        console << Uci::formatMove(m) << "/" << threshold << " => " << (engine.position().see(m, threshold) ? "PASS" : "FAIL")
+                << " (" << engine.position().seeValue(m) << ")" << std::endl;
+    } else if (token == "book") {
+        console << "Polyglot key: " << std::hex << engine.position().polyglotHash() << std::dec << std::endl;
+
+        for (auto &bm : book.moves(engine.position()))
+            console << Uci::formatMove(bm.move) << " " << bm.weight << std::endl;
+    } else if (token == "stats") {
+#ifdef STATS
+        searchStats.print();
+#else
+        console << "Search statistics are not compiled in, build with 'make stats'" << std::endl;
+#endif
     } else {
         console << engine.position() << std::endl;
     }
@@ -359,6 +527,11 @@ bool Uci::cmdStop(std::istringstream& is) {
     return true;
 }
 
+bool Uci::cmdPonderHit(std::istringstream& is) {
+    engine.ponderhit();
+    return true;
+}
+
 bool Uci::cmdQuit(std::istringstream& is) {
     return false;
 }
@@ -370,16 +543,297 @@ bool Uci::cmdTest(std::istringstream& is) {
 }
 
 bool Uci::cmdBench(std::istringstream& is) {
-    int depth = DEFAULT_BENCH_DEPTH;
-    is >> depth;
+    std::string token;
+    BenchParams params;
+    bool perf = false, repeated = false;
+
+    while (is >> token) {
+        if (token == "compare") {
+            std::string baseFile, newFile;
+            is >> baseFile >> newFile;
+            benchCompare(baseFile, newFile);
+            return true;
+        }
 
-    bench(depth);
+        if (token == "eval") {
+            int iterations = 1000;
+            if (is >> token) iterations = parseInt(token);
+            benchEval(iterations);
+            return true;
+        }
+
+        if (token == "movecount") {
+            int iterations = 1000;
+            if (is >> token) iterations = parseInt(token);
+            benchMoveCount(iterations);
+            return true;
+        }
+
+        if (token == "movepicker") {
+            int iterations = 1000;
+            if (is >> token) iterations = parseInt(token);
+            benchMovePicker(iterations);
+            return true;
+        }
+
+        if (token == "game") {
+            int depth = 10, nbPlies = 60;
+            std::vector<int> decays;
+            if (is >> token) depth = parseInt(token);
+            if (is >> token) nbPlies = parseInt(token);
+            while (is >> token) decays.push_back(parseInt(token));
+            if (decays.empty()) decays = { 1, 2, 4, 8, 16 };
+
+            if (depth < 1) {
+                console << "Usage: bench game [depth >= 1] [plies] [decays...]" << std::endl;
+                return true;
+            }
+
+            benchGame(depth, nbPlies, decays);
+            return true;
+        }
+
+        if (token == "perf") perf = true;
+        else if (token == "runs" && is >> token) { params.runs = parseInt(token); repeated = true; }
+        else if (token == "warmup" && is >> token) { params.warmup = parseInt(token); repeated = true; }
+        else if (token == "cpu" && is >> token) { params.cpu = parseInt(token); repeated = true; }
+        else if (token == "json" && is >> token) { params.jsonFile = token; repeated = true; }
+        else if (token == "csv" && is >> token) { params.csvFile = token; repeated = true; }
+        else params.depth = parseInt(token);
+    }
+
+    if (perf) benchPerf(params.depth);
+    else if (repeated) benchRuns(params);
+    else bench(params.depth);
     
     return true;
 }
 
-void UciEngine::onSearchProgress(const SearchEvent &event) {
-    console << "info"
+bool Uci::cmdAnalyse(std::istringstream& is) {
+    std::string token;
+    AnalyseParams params;
+
+    if (!(is >> params.filename)) {
+        console << "Usage: analyse <file.epd> [depth N] [nodes N] [movetime N] [threads N] [hash N] [sharedhash]" << std::endl;
+        return true;
+    }
+
+    while (is >> token) {
+        if (token == "depth") {
+            is >> token;
+            params.limits.maxDepth = parseInt(token);
+        } else if (token == "nodes") {
+            is >> token;
+            params.limits.maxNodes = parseInt64(token);
+        } else if (token == "movetime") {
+            is >> token;
+            params.limits.maxTime = parseInt(token);
+        } else if (token == "threads") {
+            is >> token;
+            params.nbThreads = parseInt(token);
+        } else if (token == "hash") {
+            is >> token;
+            params.hashSize = parseInt(token);
+        } else if (token == "sharedhash") {
+            params.sharedHash = true;
+        }
+    }
+
+    if (params.limits.maxDepth <= 0 && params.limits.maxNodes == 0 && params.limits.maxTime <= 0) {
+        params.limits.maxDepth = DEFAULT_ANALYSE_DEPTH;
+    }
+
+    analyse(params);
+
+    return true;
+}
+
+// annotate [depth N] [nodes N] [movetime N] [hash N] <file game.pgn | startpos moves ... | fen <fen> moves ...>
+// The game is given last, as in the position command. Moves are in UCI or SAN notation
+bool Uci::cmdAnnotate(std::istringstream& is) {
+    std::string token;
+    AnnotateParams params;
+
+    while (is >> token) {
+        if (token == "depth") {
+            is >> token;
+            params.limits.maxDepth = parseInt(token);
+        } else if (token == "nodes") {
+            is >> token;
+            params.limits.maxNodes = parseInt64(token);
+        } else if (token == "movetime") {
+            is >> token;
+            params.limits.maxTime = parseInt(token);
+        } else if (token == "hash") {
+            is >> token;
+            params.hashSize = parseInt(token);
+        } else if (token == "file") {
+            is >> params.filename;
+        } else if (token == "fen") {
+            params.fen.clear();
+            while (is >> token && token != "moves") {
+                params.fen += token + " ";
+            }
+            while (is >> token) params.moves.push_back(token);
+        } else if (token == "moves") {
+            while (is >> token) params.moves.push_back(token);
+        }
+    }
+
+    if (params.filename.empty() && params.moves.empty()) {
+        console << "Usage: annotate [depth N] [nodes N] [movetime N] [hash N] <file game.pgn | startpos moves ... | fen <fen> moves ...>" << std::endl;
+        return true;
+    }
+
+    if (params.limits.maxDepth <= 0 && params.limits.maxNodes == 0 && params.limits.maxTime <= 0) {
+        params.limits.maxDepth = DEFAULT_ANNOTATE_DEPTH;
+    }
+
+    annotate(params);
+
+    return true;
+}
+
+// server <port N | unix path> [workers N] [hash N]
+bool Uci::cmdServer(std::istringstream& is) {
+    std::string token;
+    ServerParams params;
+
+    while (is >> token) {
+        if (token == "port") {
+            is >> token;
+            params.port = parseInt(token);
+        } else if (token == "unix") {
+            is >> params.unixPath;
+        } else if (token == "workers") {
+            is >> token;
+            params.nbWorkers = parseInt(token);
+        } else if (token == "hash") {
+            is >> token;
+            params.hashSize = parseInt(token);
+        }
+    }
+
+    if (params.port <= 0 && params.unixPath.empty()) {
+        console << "Usage: server <port N | unix path> [workers N] [hash N]" << std::endl;
+        return true;
+    }
+
+    serve(params);
+
+    return true;
+}
+
+// selfplay [games N] [threads N] [openings file.epd] [adjudicate 0|1] [elo0 X] [elo1 X] [alpha X] [beta X]
+//          [hash N] [depth N] [nodes N] [tc base+inc]
+// Engine settings apply to both engines, or only to one of them if prefixed by "a." or "b." (ie: "a.nodes 2000")
+bool Uci::cmdSelfPlay(std::istringstream& is) {
+    std::string token, value;
+    SelfPlayParams params;
+
+    while (is >> token >> value) {
+        std::vector<SelfPlayEngineConfig *> configs = { &params.engines[0], &params.engines[1] };
+
+        if (token.starts_with("a.") || token.starts_with("b.")) {
+            configs = { &params.engines[token[0] == 'a' ? 0 : 1] };
+            token = token.substr(2);
+        }
+
+        if (token == "games") params.nbGames = parseInt(value);
+        else if (token == "threads") params.nbThreads = parseInt(value);
+        else if (token == "openings") params.openings = value;
+        else if (token == "adjudicate") params.adjudicate = parseInt(value) != 0;
+        else if (token == "elo0") params.elo0 = parseDouble(value);
+        else if (token == "elo1") params.elo1 = parseDouble(value);
+        else if (token == "alpha") params.alpha = parseDouble(value);
+        else if (token == "beta") params.beta = parseDouble(value);
+        else {
+            for (auto config : configs) {
+                if (token == "hash") config->hashSize = parseInt(value);
+                else if (token == "depth") config->depth = parseInt(value);
+                else if (token == "nodes") config->nodes = parseInt64(value);
+                else if (token == "tc") {
+                    size_t sep = value.find('+');
+                    config->time = TimeMs(1000 * parseDouble(value.substr(0, sep)));
+                    config->increment = sep == std::string::npos ? 0 : TimeMs(1000 * parseDouble(value.substr(sep + 1)));
+                }
+            }
+        }
+    }
+
+    for (auto &config : params.engines) {
+        if (config.depth <= 0 && config.nodes == 0 && config.time <= 0) config.nodes = DEFAULT_SELFPLAY_NODES;
+    }
+
+    selfplay(params);
+
+    return true;
+}
+
+bool Uci::cmdDataGen(std::istringstream& is) {
+    std::string token, value;
+    DataGenParams params;
+    params.seed = uint64_t(now());
+
+    // "datagen convert <input> <output>": a .bin input is converted to text, anything else to binary
+    if (is >> std::ws && is.peek() == 'c') {
+        std::string input, output;
+        is >> token >> input >> output;
+        if (token != "convert" || output.empty()) {
+            console << "Usage: datagen convert <input> <output>" << std::endl;
+            return true;
+        }
+
+        bool toText = input.ends_with(".bin");
+        int64_t count = convertPackedFile(input, output, toText);
+
+        if (count < 0) console << "Unable to convert '" << input << "' to '" << output << "'" << std::endl;
+        else console << "Converted " << count << " positions to " << (toText ? "text" : "binary") << std::endl;
+
+        return true;
+    }
+
+    while (is >> token >> value) {
+        if (token == "positions") params.nbPositions = parseInt64(value);
+        else if (token == "threads") params.nbThreads = parseInt(value);
+        else if (token == "nodes") params.nodes = parseInt64(value);
+        else if (token == "hash") params.hashSize = parseInt(value);
+        else if (token == "random") params.randomPlies = parseInt(value);
+        else if (token == "seed") params.seed = parseInt64(value);
+        else if (token == "output") params.filename = value;
+    }
+
+    datagen(params);
+
+    return true;
+}
+
+bool Uci::cmdTune(std::istringstream& is) {
+    std::string token, value;
+    TuneParams params;
+
+    if (!(is >> params.filename)) {
+        console << "Usage: tune <file> [threads N] [epochs N] [lr X] [positions N] [output file]" << std::endl;
+        return true;
+    }
+
+    while (is >> token >> value) {
+        if (token == "threads") params.nbThreads = parseInt(value);
+        else if (token == "epochs") params.epochs = parseInt(value);
+        else if (token == "lr") params.learningRate = parseDouble(value);
+        else if (token == "positions") params.maxPositions = parseInt64(value);
+        else if (token == "output") params.output = value;
+    }
+
+    tune(params);
+
+    return true;
+}
+
+std::string Uci::formatInfo(const SearchEvent &event) {
+    std::ostringstream ss;
+
+    ss << "info"
         << " depth " << event.depth 
         << " seldepth " << event.selDepth 
         << " multipv " << 1
@@ -391,16 +845,30 @@ void UciEngine::onSearchProgress(const SearchEvent &event) {
         << " tbhits " << 0;
 
     if (!event.pv.empty()) 
-        console << " pv " << event.pv;
-    
-    console << std::endl;
+        ss << " pv " << event.pv;
+
+    return ss.str();
 }
 
-void UciEngine::onSearchFinish(const SearchEvent &event) {
+std::string Uci::formatBestMove(const SearchEvent &event) {
     Move bestMove = MOVE_NONE;
     if (!event.pv.empty()) bestMove = event.pv.front();
 
-    console << "bestmove " << Uci::formatMove(bestMove) << std::endl;
+    std::string str = "bestmove " + Uci::formatMove(bestMove);
+
+    if (event.pv.size() > 1)
+        str += " ponder " + Uci::formatMove(event.pv[1]);
+
+    return str;
+}
+
+void UciEngine::onSearchProgress(const SearchEvent &event) {
+    console << Uci::formatInfo(event) << std::endl;
+}
+
+void UciEngine::onSearchFinish(const SearchEvent &event) {
+    console << Uci::formatBestMove(event) << std::endl;
+    console.flush(); // The GUI is waiting for it
 }
 
 
@@ -9,8 +9,12 @@
 #include <iomanip>
 #include <fstream>
 #include <filesystem>
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include "uci_option.h"
 #include "engine.h"
+#include "book.h"
 
 #define VERSION "3.1.0-DEV"
 
@@ -18,10 +22,13 @@ namespace Belette {
 
 typedef std::ostream& (*Manipulator) (std::ostream&);
 
-// Used to log stdin & stdout to a file for debugging
+// Engine output, also used to log stdin & stdout to a file for debugging
+// Lines are formatted in a per thread buffer and pushed to a lock free queue, a background thread writes
+// them to stdout and to the log file so searching threads never wait on I/O. The thread is started by the
+// first line, not when the program or the library is loaded
 class Console {
 public:
-    Console() = default;
+    Console();
     Console(const Console &) = delete;
     ~Console();
     Console &operator=(const Console &) = delete;
@@ -29,51 +36,72 @@ public:
     void setLogFile(const std::string &filename);
     std::istream& getline(std::string& str);
 
+    // Wait until everything written so far is flushed to stdout and to the log file
+    void flush();
+
     template <class T> friend Console& operator<<(Console& console, const T& x);
     friend Console& operator<<(Console& console, Manipulator manip);
 private:
-    template <class T> Console &log(const T& x, bool isInput = false);
+    struct Line {
+        std::atomic<Line*> next = nullptr;
+        std::string text;
+        time_t time;
+        bool isInput;
+    };
+
+    // Multi producer single consumer queue: producers append at head, the writer thread consumes from tail
+    std::atomic<Line*> head;
+    Line *tail;
+
+    std::atomic<uint64_t> nbPushed = 0;
+    std::atomic<uint64_t> nbWritten = 0;
+    std::atomic<bool> stopping = false;
+    std::atomic<bool> logging = false;
+
+    std::mutex fileMutex;
+    std::ofstream *file = nullptr;
+
+    std::once_flag writerStarted;
+    std::thread writer;
 
-    std::stringstream buffer;
-    std::ofstream *file;
+    inline std::ostringstream &buffer() {
+        static thread_local std::ostringstream threadBuffer;
+        return threadBuffer;
+    }
+
+    inline void commit(std::ostringstream &buffer) {
+        if (!buffer.view().ends_with('\n')) return;
+        push(buffer.str(), false);
+        buffer.str(std::string()); // clear buffer
+        // Formatting set for a line (std::fixed, std::hex...) doesn't carry over to the next ones
+        buffer.flags(std::ios_base::skipws | std::ios_base::dec);
+        buffer.precision(6);
+        buffer.width(0);
+        buffer.fill(' ');
+    }
+
+    void push(std::string &&text, bool isInput);
+    void writeLines();
+    void writerLoop();
 };
 
 extern Console console;
 
 inline Console& operator<<(Console& console, Manipulator x) {
-    std::cout << x;
-    console.log(x);
+    std::ostringstream &buffer = console.buffer();
+    buffer << x;
+    console.commit(buffer);
     return console;
 }
 
 template <class T>
 inline Console& operator<<(Console& console, const T& x) { 
-    std::cout << x;
-    console.log(x);
+    std::ostringstream &buffer = console.buffer();
+    buffer << x;
+    console.commit(buffer);
     return console;
 }
 
-template <class T> Console& Console::log(const T& x, bool isInput) {
-    if (file != nullptr) {
-        if (buffer.rdbuf()->in_avail() == 0) {
-            auto now = time(nullptr);
-            buffer << "[" << std::put_time(std::localtime(&now), "%F %T") << "] " << (isInput ? "<< " : ">> ");
-        }
-        buffer << x;
-
-        if (buffer.str().ends_with('\n')) {
-            (*file) << buffer.str();
-            file->flush();
-            buffer.str(std::string()); // clear buffer
-        }
-        
-    }
-
-    return *this;
-}
-
-
-
 class UciEngine : public Engine {
 protected:
     virtual void onSearchProgress(const SearchEvent &event);
@@ -86,12 +114,20 @@ public:
     ~Uci() = default;
     void loop(int argc, char* argv[]);
 
+    bool execute(const std::string &line);
+
     Move parseMove(std::string str) const;
 
+    static Move parseMove(const Position &pos, std::string str);
+    static bool parsePosition(std::istringstream& is, Position &pos);
+    static SearchLimits parseSearchLimits(std::istringstream& is, const Position &pos);
+
     static Square parseSquare(std::string str);
     static std::string formatSquare(Square sq);
     static std::string formatMove(Move m);
     static std::string formatScore(Score s);
+    static std::string formatInfo(const SearchEvent &event);
+    static std::string formatBestMove(const SearchEvent &event);
     
 private:
     typedef bool (Uci::*UciCommandHandler)(std::istringstream& is);
@@ -106,6 +142,9 @@ private:
     std::map<std::string, UciOption, CaseInsensitiveComparator> options;
     std::map<std::string, UciCommandHandler> commands;
     UciEngine engine;
+    Book book;
+
+    void updateBook();
 
     bool cmdUci(std::istringstream& is);
     bool cmdIsReady(std::istringstream& is);
@@ -114,6 +153,7 @@ private:
     bool cmdPosition(std::istringstream& is);
     bool cmdGo(std::istringstream& is);
     bool cmdStop(std::istringstream& is);
+    bool cmdPonderHit(std::istringstream& is);
     bool cmdQuit(std::istringstream& is);
 
     bool cmdDebug(std::istringstream& is);
@@ -122,6 +162,12 @@ private:
     bool cmdPerftmp(std::istringstream& is);
     bool cmdTest(std::istringstream& is);
     bool cmdBench(std::istringstream& is);
+    bool cmdAnalyse(std::istringstream& is);
+    bool cmdAnnotate(std::istringstream& is);
+    bool cmdServer(std::istringstream& is);
+    bool cmdSelfPlay(std::istringstream& is);
+    bool cmdDataGen(std::istringstream& is);
+    bool cmdTune(std::istringstream& is);
 };
 
 } /* namespace Belette */
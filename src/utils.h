@@ -36,6 +36,18 @@ inline int64_t parseInt64(const std::string &str) {
     return 0;
 }
 
+inline double parseDouble(const std::string &str) {
+    try {
+        return std::stod(str);
+    } catch (const std::invalid_argument & e) {
+        return 0;
+    } catch (const std::out_of_range & e) {
+        return 0;
+    }
+
+    return 0;
+}
+
 // https://stackoverflow.com/questions/9779105/generic-member-function-pointer-as-a-template-parameter
 template <typename T, typename R, typename ...Args>
 class MemberFunctionProxy {
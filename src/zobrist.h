@@ -1,17 +1,23 @@
 #ifndef ZOBRIST_H_INCLUDED
 #define ZOBRIST_H_INCLUDED
 
+#include <array>
 #include "chess.h"
 
 namespace Belette {
 
 namespace Zobrist {
-    extern Bitboard keys[NB_PIECE][NB_SQUARE];
-    extern Bitboard enpassantKeys[NB_FILE+1];
-    extern Bitboard castlingKeys[NB_CASTLING_RIGHT];
-    extern Bitboard sideToMoveKey;
+    extern const std::array<std::array<Bitboard, NB_SQUARE>, NB_PIECE> keys;
+    extern const std::array<Bitboard, NB_FILE+1> enpassantKeys;
+    extern const std::array<Bitboard, NB_CASTLING_RIGHT> castlingKeys;
+    extern const Bitboard sideToMoveKey;
 
-    void init();
+    constexpr int POLYGLOT_NB_KEYS = 781;
+    constexpr int POLYGLOT_CASTLING_OFFSET = 768;
+    constexpr int POLYGLOT_ENPASSANT_OFFSET = 772;
+    constexpr int POLYGLOT_TURN_OFFSET = 780;
+
+    extern const std::array<uint64_t, POLYGLOT_NB_KEYS> polyglotKeys;
 }
 
 } /* namespace Belette */